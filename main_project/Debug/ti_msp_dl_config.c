@@ -56,8 +56,11 @@ SYSCONFIG_WEAK void SYSCFG_DL_init(void)
     SYSCFG_DL_SYSCTL_init();
     SYSCFG_DL_PWM_0_init();
     SYSCFG_DL_PWM_1_init();
+    SYSCFG_DL_TIMER_0_init();
     SYSCFG_DL_UART_0_init();
     SYSCFG_DL_SPI_0_init();
+    SYSCFG_DL_COMP_LIGHT_init();
+    SYSCFG_DL_TRNG_init();
     /* Ensure backup structures have no valid state */
 	gPWM_0Backup.backupRdy 	= false;
 	gPWM_1Backup.backupRdy 	= false;
@@ -98,15 +101,23 @@ SYSCONFIG_WEAK void SYSCFG_DL_initPower(void)
     DL_GPIO_reset(GPIOB);
     DL_TimerA_reset(PWM_0_INST);
     DL_TimerA_reset(PWM_1_INST);
+    DL_TimerG_reset(TIMER_0_INST);
     DL_UART_Main_reset(UART_0_INST);
     DL_SPI_reset(SPI_0_INST);
+    DL_MathACL_reset(MATHACL);
+    DL_COMP_reset(COMP_LIGHT_INST);
+    DL_TRNG_reset(TRNG);
 
     DL_GPIO_enablePower(GPIOA);
     DL_GPIO_enablePower(GPIOB);
     DL_TimerA_enablePower(PWM_0_INST);
     DL_TimerA_enablePower(PWM_1_INST);
+    DL_TimerG_enablePower(TIMER_0_INST);
     DL_UART_Main_enablePower(UART_0_INST);
     DL_SPI_enablePower(SPI_0_INST);
+    DL_MathACL_enablePower(MATHACL);
+    DL_COMP_enablePower(COMP_LIGHT_INST);
+    DL_TRNG_enablePower(TRNG);
     delay_cycles(POWER_STARTUP_DELAY);
 }
 
@@ -142,6 +153,14 @@ SYSCONFIG_WEAK void SYSCFG_DL_GPIO_init(void)
 
     DL_GPIO_initDigitalOutput(EXTRA_CS_IOMUX);
 
+    DL_GPIO_initDigitalInputFeatures(TAMPER_COVER_IOMUX,
+		 DL_GPIO_INVERSION_DISABLE, DL_GPIO_RESISTOR_PULL_UP,
+		 DL_GPIO_HYSTERESIS_ENABLE, DL_GPIO_WAKEUP_DISABLE);
+
+    DL_GPIO_initDigitalInputFeatures(TAMPER_REED_IOMUX,
+		 DL_GPIO_INVERSION_DISABLE, DL_GPIO_RESISTOR_PULL_UP,
+		 DL_GPIO_HYSTERESIS_ENABLE, DL_GPIO_WAKEUP_DISABLE);
+
     DL_GPIO_clearPins(GPIOA, EXTRA_RST_PIN |
 		EXTRA_DC_PIN);
     DL_GPIO_enableOutput(GPIOA, EXTRA_RST_PIN |
@@ -152,6 +171,14 @@ SYSCONFIG_WEAK void SYSCFG_DL_GPIO_init(void)
     DL_GPIO_enableOutput(GPIOB, GPIO_LED_booster_led_blue_PIN |
 		GPIO_LED_booster_led_green_PIN |
 		EXTRA_CS_PIN);
+    DL_GPIO_setUpperPinsPolarity(TAMPER_PORT, DL_GPIO_PIN_21_EDGE_RISE_FALL |
+		DL_GPIO_PIN_20_EDGE_RISE_FALL);
+    DL_GPIO_setUpperPinsInputFilter(TAMPER_PORT, DL_GPIO_PIN_21_INPUT_FILTER_8_CYCLES |
+		DL_GPIO_PIN_20_INPUT_FILTER_8_CYCLES);
+    DL_GPIO_clearInterruptStatus(TAMPER_PORT, TAMPER_COVER_PIN |
+		TAMPER_REED_PIN);
+    DL_GPIO_enableInterrupt(TAMPER_PORT, TAMPER_COVER_PIN |
+		TAMPER_REED_PIN);
 
 }
 
@@ -259,6 +286,45 @@ SYSCONFIG_WEAK void SYSCFG_DL_PWM_1_init(void) {
     DL_TimerA_setCCPDirection(PWM_1_INST , DL_TIMER_CC1_OUTPUT );
 
 
+}
+
+
+
+/*
+ * Timer clock configuration to be sourced by LFCLK /  (32768 Hz)
+ * timerClkFreq = (timerClkSrc / (timerClkDivRatio * (timerClkPrescale + 1)))
+ *   32768 Hz = 32768 Hz / (1 * (0 + 1))
+ */
+static const DL_TimerG_ClockConfig gTIMER_0ClockConfig = {
+    .clockSel    = DL_TIMER_CLOCK_LFCLK,
+    .divideRatio = DL_TIMER_CLOCK_DIVIDE_1,
+    .prescale    = 0U,
+};
+
+/*
+ * Timer load value (where the counter starts from) is calculated as (timerPeriod * timerClockFreq) - 1
+ * TIMER_0_INST_LOAD_VALUE = (2 s * 32768 Hz) - 1
+ */
+static const DL_TimerG_TimerConfig gTIMER_0TimerConfig = {
+    .period     = TIMER_0_INST_LOAD_VALUE,
+    .timerMode  = DL_TIMER_TIMER_MODE_PERIODIC,
+    .startTimer = DL_TIMER_STOP,
+};
+
+SYSCONFIG_WEAK void SYSCFG_DL_TIMER_0_init(void) {
+
+    DL_TimerG_setClockConfig(TIMER_0_INST,
+        (DL_TimerG_ClockConfig *) &gTIMER_0ClockConfig);
+
+    DL_TimerG_initTimerMode(TIMER_0_INST,
+        (DL_TimerG_TimerConfig *) &gTIMER_0TimerConfig);
+    DL_TimerG_enableInterrupt(TIMER_0_INST , DL_TIMERG_INTERRUPT_CC0_DN_EVENT |
+		DL_TIMERG_INTERRUPT_ZERO_EVENT);
+    DL_TimerG_enableClock(TIMER_0_INST);
+
+
+
+
 }
 
 
@@ -290,6 +356,10 @@ SYSCONFIG_WEAK void SYSCFG_DL_UART_0_init(void)
     DL_UART_Main_setBaudRateDivisor(UART_0_INST, UART_0_IBRD_8_MHZ_115200_BAUD, UART_0_FBRD_8_MHZ_115200_BAUD);
 
 
+    /* Configure Interrupts */
+    DL_UART_Main_enableInterrupt(UART_0_INST,
+                                 DL_UART_MAIN_INTERRUPT_RX);
+
 
     DL_UART_Main_enable(UART_0_INST);
 }
@@ -327,3 +397,43 @@ SYSCONFIG_WEAK void SYSCFG_DL_SPI_0_init(void) {
     DL_SPI_enable(SPI_0_INST);
 }
 
+/* COMP_LIGHT Initialization */
+static const DL_COMP_Config gCOMP_LIGHTConfig = {
+    .channelEnable = DL_COMP_ENABLE_CHANNEL_POS,
+    .mode          = DL_COMP_MODE_ULP,
+    .negChannel    = DL_COMP_IMSEL_CHANNEL_0,
+    .posChannel    = DL_COMP_IPSEL_CHANNEL_0,
+    .hysteresis    = DL_COMP_HYSTERESIS_20,
+    .polarity      = DL_COMP_POLARITY_NON_INV
+};
+static const DL_COMP_RefVoltageConfig gCOMP_LIGHTVRefConfig = {
+    .mode           = DL_COMP_REF_MODE_STATIC,
+    .source         = DL_COMP_REF_SOURCE_VDDA_DAC,
+    .terminalSelect = DL_COMP_REF_TERMINAL_SELECT_NEG,
+    .controlSelect  = DL_COMP_DAC_CONTROL_SW,
+    .inputSelect    = DL_COMP_DAC_INPUT_DACCODE0
+};
+
+SYSCONFIG_WEAK void SYSCFG_DL_COMP_LIGHT_init(void)
+{
+    DL_COMP_init(COMP_LIGHT_INST, (DL_COMP_Config *) &gCOMP_LIGHTConfig);
+    DL_COMP_refVoltageInit(COMP_LIGHT_INST, (DL_COMP_RefVoltageConfig *) &gCOMP_LIGHTVRefConfig);
+    DL_COMP_setDACCode0(COMP_LIGHT_INST, COMP_LIGHT_DACCODE0);
+    DL_COMP_enableOutputFilter(COMP_LIGHT_INST, DL_COMP_FILTER_DELAY_1200);
+    DL_COMP_clearInterruptStatus(COMP_LIGHT_INST, (DL_COMP_INTERRUPT_OUTPUT_EDGE |
+		DL_COMP_INTERRUPT_OUTPUT_EDGE_INV));
+    DL_COMP_enableInterrupt(COMP_LIGHT_INST, (DL_COMP_INTERRUPT_OUTPUT_EDGE |
+		DL_COMP_INTERRUPT_OUTPUT_EDGE_INV));
+    DL_COMP_enable(COMP_LIGHT_INST);
+}
+
+SYSCONFIG_WEAK void SYSCFG_DL_TRNG_init(void)
+{
+    DL_TRNG_setClockDivider(TRNG, DL_TRNG_CLOCK_DIVIDE_2);
+    DL_TRNG_sendCommand(TRNG, DL_TRNG_CMD_NORM_FUNC);
+    while (!DL_TRNG_isCommandDone(TRNG))
+        ;
+    DL_TRNG_clearInterruptStatus(TRNG, DL_TRNG_INTERRUPT_CMD_DONE_EVENT);
+    DL_TRNG_setDecimationRate(TRNG, DL_TRNG_DECIMATION_RATE_4);
+}
+
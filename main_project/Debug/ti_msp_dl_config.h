@@ -104,6 +104,14 @@ extern "C" {
 
 
 
+/* Defines for TIMER_0 */
+#define TIMER_0_INST                                                     (TIMG0)
+#define TIMER_0_INST_IRQHandler                                 TIMG0_IRQHandler
+#define TIMER_0_INST_INT_IRQN                                   (TIMG0_INT_IRQn)
+#define TIMER_0_INST_LOAD_VALUE                                         (65535U)
+
+
+
 /* Defines for UART_0 */
 #define UART_0_INST                                                        UART0
 #define UART_0_INST_FREQUENCY                                            8000000
@@ -148,6 +156,19 @@ extern "C" {
 
 
 
+/* Defines for COMP_LIGHT */
+#define COMP_LIGHT_INST                                                   COMP0
+#define COMP_LIGHT_INST_IRQHandler                              COMP0_IRQHandler
+#define COMP_LIGHT_INST_INT_IRQN                                (COMP0_INT_IRQn)
+#define COMP_LIGHT_DACCODE0                                                (128)
+/* GPIO configuration for COMP_LIGHT */
+#define GPIO_COMP_LIGHT_IN0POS_PORT                                      (GPIOA)
+#define GPIO_COMP_LIGHT_IN0POS_PIN                              (DL_GPIO_PIN_26)
+#define GPIO_COMP_LIGHT_IOMUX_IN0POS                             (IOMUX_PINCM59)
+#define GPIO_COMP_LIGHT_IOMUX_IN0POS_FUNC             (IOMUX_PINCM59_PF_UNCONNECTED)
+
+
+
 /* Port definition for Pin Group GPIO_LED */
 #define GPIO_LED_PORT                                                    (GPIOB)
 
@@ -169,6 +190,20 @@ extern "C" {
 #define EXTRA_CS_PORT                                                    (GPIOB)
 #define EXTRA_CS_PIN                                            (DL_GPIO_PIN_13)
 #define EXTRA_CS_IOMUX                                           (IOMUX_PINCM30)
+/* Port definition for Pin Group TAMPER */
+#define TAMPER_PORT                                                      (GPIOB)
+
+/* Defines for COVER: GPIOB.21 with pinCMx 49 on package pin 20 */
+// pins affected by this interrupt request:["COVER","REED"]
+#define TAMPER_INT_IRQN                                         (GPIOB_INT_IRQn)
+#define TAMPER_INT_IIDX                         (DL_INTERRUPT_GROUP1_IIDX_GPIOB)
+#define TAMPER_COVER_IIDX                                   (DL_GPIO_IIDX_DIO21)
+#define TAMPER_COVER_PIN                                        (DL_GPIO_PIN_21)
+#define TAMPER_COVER_IOMUX                                       (IOMUX_PINCM49)
+/* Defines for REED: GPIOB.20 with pinCMx 48 on package pin 19 */
+#define TAMPER_REED_IIDX                                    (DL_GPIO_IIDX_DIO20)
+#define TAMPER_REED_PIN                                         (DL_GPIO_PIN_20)
+#define TAMPER_REED_IOMUX                                        (IOMUX_PINCM48)
 
 
 /* clang-format on */
@@ -179,8 +214,11 @@ void SYSCFG_DL_GPIO_init(void);
 void SYSCFG_DL_SYSCTL_init(void);
 void SYSCFG_DL_PWM_0_init(void);
 void SYSCFG_DL_PWM_1_init(void);
+void SYSCFG_DL_TIMER_0_init(void);
 void SYSCFG_DL_UART_0_init(void);
 void SYSCFG_DL_SPI_0_init(void);
+void SYSCFG_DL_COMP_LIGHT_init(void);
+void SYSCFG_DL_TRNG_init(void);
 
 
 bool SYSCFG_DL_saveConfiguration(void);
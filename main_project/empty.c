@@ -7,9 +7,16 @@
 
 #include "ti_msp_dl_config.h"
 #include <stdbool.h>
+#include <stddef.h>
+#include "fft_q15.h"
+#include "fmt.h"
+#include "sha256.h"
 
 /* ============== TIMING CONSTANTS ============== */
 #define DELAY (3000)  // 3 seconds delay between updates
+#define POWER_REPORT_EVERY (20)  // send power stats every 20 base periods
+#define FMT_BENCH (0)  // 1 = report formatter cycle counts once at boot
+#define HARM_SIMULATED (1)  // 1 = harm_window is synthesised, not sampled from a CT
 
 /* ============== DISPLAY GPIO ============== */
 #define DC_LOW()   DL_GPIO_clearPins(EXTRA_DC_PORT, EXTRA_DC_PIN)
@@ -34,32 +41,6 @@ uint16_t random_range(uint16_t min, uint16_t max)
     return min + (seed % (max - min + 1));
 }
 
-/* ============== STRING CONVERSION ============== */
-void int_to_string(uint16_t num, char* str)
-{
-    int i = 0;
-    if (num == 0) {
-        str[0] = '0';
-        str[1] = '\0';
-        return;
-    }
-    
-    while (num > 0) {
-        str[i++] = (num % 10) + '0';
-        num /= 10;
-    }
-    str[i] = '\0';
-    
-    int start = 0, end = i - 1;
-    while (start < end) {
-        char temp = str[start];
-        str[start] = str[end];
-        str[end] = temp;
-        start++;
-        end--;
-    }
-}
-
 /* ============== TIME MANAGEMENT ============== */
 typedef struct {
     uint8_t day;
@@ -83,11 +64,85 @@ void datetime_add_minutes(DateTime* dt, uint8_t minutes)
     }
 }
 
+/* ============== DEVICE IDENTITY ============== */
+// "MTR-" + the factory region's TRACEID, which TI programs uniquely into
+// every die. Readings, tamper events and the boot frame carry it, so the
+// host knows which meter sent a frame whichever port it arrived on.
+static char device_id[] = "MTR-00000000";
+
+// Random per-boot nonce from the TRNG, sent next to the device id. Frame
+// sequence numbers restart at 1 on every reset; the host keys its replay
+// windows on (dev, boot), so frames recorded under an earlier boot are
+// never accepted again and a new boot is recognised from any frame.
+static char boot_id[] = "00000000";
+
+static void id_hex32(char* out, uint32_t value)
+{
+    static const char hex[] = "0123456789ABCDEF";
+
+    for (uint8_t i = 0; i < 8; i++) {
+        out[i] = hex[(value >> (28 - 4 * i)) & 0x0F];
+    }
+}
+
+static void device_id_init(void)
+{
+    id_hex32(&device_id[4], DL_FactoryRegion_getTraceID());
+}
+
+static void boot_id_init(void)
+{
+    uint32_t nonce = 0;
+
+    // First capture after power-up is discarded, the second one is used
+    for (uint8_t i = 0; i < 2; i++) {
+        while (!DL_TRNG_isCaptureReady(TRNG));
+        DL_TRNG_clearInterruptStatus(TRNG, DL_TRNG_INTERRUPT_CAPTURE_RDY_EVENT);
+        nonce = DL_TRNG_getCapture(TRNG);
+    }
+    id_hex32(boot_id, nonce);
+
+    // Nothing else needs entropy: power the noise source down again
+    DL_TRNG_sendCommand(TRNG, DL_TRNG_CMD_PWROFF);
+}
+
+/* ============== FRAME AUTHENTICATION ============== */
+// Readings, tamper events and capture frames end in ,"mac":"<32 hex digits>":
+// HMAC-SHA256 over every byte of the line before that field, truncated to
+// 128 bits.
+// Each byte is hashed right after it is queued, while the UART is still
+// shifting it out. The key's ipad/opad blocks are hashed once at boot.
+// The development key below is replaced per device at provisioning
+// (-DFRAME_KEY=...) and registered in the host's device_keys.json.
+#ifndef FRAME_KEY
+#define FRAME_KEY  "smart-meter-dev-key-change-me!!"
+#endif
+#define FRAME_MAC_BYTES  (16)
+
+static HmacSha256Key frame_key;
+static Sha256Ctx frame_mac;
+static bool frame_mac_active = false;
+
+static void frame_auth_init(void)
+{
+    hmac_sha256_key(&frame_key, (const uint8_t*)FRAME_KEY, sizeof(FRAME_KEY) - 1);
+}
+
+// Every byte sent until frame_mac_end() is authenticated
+static void frame_mac_begin(void)
+{
+    hmac_sha256_begin(&frame_key, &frame_mac);
+    frame_mac_active = true;
+}
+
 /* ============== UART FUNCTIONS ============== */
 void uart_send_char(char c)
 {
     while(DL_UART_isBusy(UART_0_INST));
     DL_UART_Main_transmitData(UART_0_INST, c);
+    if (frame_mac_active) {
+        sha256_update(&frame_mac, (const uint8_t*)&c, 1);
+    }
 }
 
 void uart_send_string(const char *str)
@@ -98,33 +153,97 @@ void uart_send_string(const char *str)
     }
 }
 
-void send_sensor_data(bool tampered, uint16_t voltage, uint16_t current, uint16_t temp, uint16_t light, uint16_t mag)
+static void uart_send_field(const char *key, uint32_t value)
+{
+    char buffer[FMT_U32_MAX];
+
+    uart_send_string(",\"");
+    uart_send_string(key);
+    uart_send_string("\":");
+    fmt_u32(buffer, value);
+    uart_send_string(buffer);
+}
+
+static void uart_send_device_id(void)
+{
+    uart_send_string(",\"dev\":\"");
+    uart_send_string(device_id);
+    uart_send_string("\",\"boot\":\"");
+    uart_send_string(boot_id);
+    uart_send_char('"');
+}
+
+// Closes a frame opened with frame_mac_begin()
+static void frame_mac_end(void)
+{
+    static const char hex[] = "0123456789abcdef";
+    uint8_t mac[SHA256_DIGEST];
+
+    frame_mac_active = false;
+    hmac_sha256_final(&frame_key, &frame_mac, mac);
+    uart_send_string(",\"mac\":\"");
+    for (uint8_t i = 0; i < FRAME_MAC_BYTES; i++) {
+        uart_send_char(hex[mac[i] >> 4]);
+        uart_send_char(hex[mac[i] & 0x0F]);
+    }
+    uart_send_string("\"}\r\n");
+}
+
+// seq counts sensor frames since reset (the host detects gaps from it);
+// t is the systime the channels were sampled, for end-to-end latency
+void send_sensor_data(bool tampered, uint16_t voltage, uint16_t current, uint16_t temp, uint16_t light, uint16_t mag,
+                      uint16_t capture_id, const HarmonicFeatures* harm, uint32_t seq, uint32_t t)
 {
     char buffer[16];
     
-    uart_send_string("{\"voltage\":");
-    int_to_string(voltage, buffer);
+    frame_mac_begin();
+    uart_send_string("{\"seq\":");
+    fmt_u32(buffer, seq);
+    uart_send_string(buffer);
+    uart_send_device_id();
+    uart_send_field("t", t);
+
+    uart_send_string(",\"voltage\":");
+    fmt_u32(buffer, voltage);
     uart_send_string(buffer);
     
     uart_send_string(",\"current\":");
-    int_to_string(current, buffer);
+    fmt_u32(buffer, current);
     uart_send_string(buffer);
     
     uart_send_string(",\"temperature\":");
-    int_to_string(temp, buffer);
+    fmt_u32(buffer, temp);
     uart_send_string(buffer);
     
     uart_send_string(",\"lightIntensity\":");
-    int_to_string(light, buffer);
+    fmt_u32(buffer, light);
     uart_send_string(buffer);
     
     uart_send_string(",\"magneticField\":");
-    int_to_string(mag, buffer);
+    fmt_u32(buffer, mag);
     uart_send_string(buffer);
     
     uart_send_string(",\"tamperFlag\":");
     uart_send_char(tampered ? '1' : '0');
-    uart_send_string("}\r\n");
+
+    // Waveform capture that this frame triggered, streamed separately
+    if (capture_id) {
+        uart_send_field("capture", capture_id);
+    }
+
+    // Current harmonics h1..h8 (peak counts) and THD, when freshly analysed
+    if (harm) {
+        uart_send_field("thd", harm->thd_permille);
+        uart_send_field("hsim", HARM_SIMULATED);
+        uart_send_string(",\"harm\":[");
+        for (uint8_t h = 0; h < FFT_HARMONICS; h++) {
+            if (h) uart_send_char(',');
+            fmt_u32(buffer, harm->magnitude[h]);
+            uart_send_string(buffer);
+        }
+        uart_send_char(']');
+    }
+    frame_mac_end();
 }
 
 /* ============== DELAY FUNCTIONS ============== */
@@ -133,11 +252,490 @@ void delay_ms(uint32_t ms)
     while (ms--) delay_cycles(32000);
 }
 
+/* ============== TIME BASE (TIMER_0 on LFCLK) ============== */
+#define LFCLK_HZ         (32768U)
+#define MS_TO_TICKS(ms)  (((uint32_t)(ms) * LFCLK_HZ) / 1000U)
+#define TIMER_0_SPAN     (TIMER_0_INST_LOAD_VALUE + 1U)
+
+static volatile uint32_t systime_epoch = 0;
+
+// Monotonic LFCLK tick count (1 tick = 30.5 us, wraps after ~36 hours)
+uint32_t systime_now(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t count = DL_TimerG_getTimerCount(TIMER_0_INST);
+    uint32_t epoch = systime_epoch;
+
+    // Reload happened but the ISR has not run yet
+    if (DL_TimerG_getRawInterruptStatus(TIMER_0_INST, DL_TIMERG_INTERRUPT_ZERO_EVENT) &&
+        count > (TIMER_0_INST_LOAD_VALUE / 2)) {
+        epoch += TIMER_0_SPAN;
+    }
+
+    __set_PRIMASK(primask);
+    return epoch + (TIMER_0_INST_LOAD_VALUE - count);
+}
+
+static inline bool systime_reached(uint32_t deadline)
+{
+    return (int32_t)(systime_now() - deadline) >= 0;
+}
+
+static inline uint32_t systime_earliest(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0 ? a : b;
+}
+
+// Wake on CC0 if the deadline lands before the next reload, else on ZERO
+static void systime_arm_wakeup(uint32_t deadline)
+{
+    uint32_t delta = deadline - systime_now();
+    uint32_t count = DL_TimerG_getTimerCount(TIMER_0_INST);
+
+    if (delta < count) {
+        DL_TimerG_setCaptureCompareValue(TIMER_0_INST, count - delta, DL_TIMER_CC_0_INDEX);
+    }
+}
+
+void TIMER_0_INST_IRQHandler(void)
+{
+    switch (DL_TimerG_getPendingInterrupt(TIMER_0_INST)) {
+        case DL_TIMER_IIDX_ZERO:
+            systime_epoch += TIMER_0_SPAN;
+            break;
+        case DL_TIMER_IIDX_CC0_DN:
+            break;
+        default:
+            break;
+    }
+}
+
+/* ============== CYCLE COUNTER (SysTick) ============== */
+// Free-running 24-bit down-counter on MCLK, used for profiling only
+#define CYCLES_MASK  (0x00FFFFFFU)
+
+static void cycle_counter_init(void)
+{
+    SysTick->LOAD = CYCLES_MASK;
+    SysTick->VAL = 0;
+    SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk;
+}
+
+static inline uint32_t cycle_now(void)
+{
+    return SysTick->VAL;
+}
+
+// Valid for spans up to 2^24 cycles (~0.5 s at 32 MHz)
+static inline uint32_t cycles_since(uint32_t start)
+{
+    return (start - SysTick->VAL) & CYCLES_MASK;
+}
+
+/* ============== POWER MANAGER ============== */
+typedef enum {
+    PM_RUN = 0,
+    PM_SLEEP,
+    PM_STOP,
+    PM_STANDBY,
+    PM_MODE_COUNT
+} PowerMode;
+
+// Minimum idle time before a mode pays off (LFCLK ticks)
+#define PM_STOP_MIN_TICKS     (4U)    // ~120 us
+#define PM_STANDBY_MIN_TICKS  (33U)   // ~1 ms, covers PD1 save/restore
+
+typedef struct {
+    uint32_t residency[PM_MODE_COUNT];     // ticks spent in each mode
+    uint32_t entries[PM_MODE_COUNT];
+    uint32_t wake_latency_max[PM_MODE_COUNT];  // ticks late vs. deadline
+    uint32_t wake_latency_sum[PM_MODE_COUNT];
+    uint32_t wake_count[PM_MODE_COUNT];
+    uint32_t restore_failures;
+} PowerStats;
+
+static PowerStats pm_stats;
+static uint32_t pm_last_wake = 0;
+
+// Set by modules that must keep their clocks running (limits to SLEEP)
+#define PM_HOLD_UART_RX  (1U << 0)
+
+static volatile uint32_t pm_hold = 0;
+// Set by ISRs that need the main loop to run before the next deadline
+static volatile bool pm_event_pending = false;
+
+static PowerMode power_select_mode(uint32_t remaining)
+{
+    if (pm_hold || DL_UART_isBusy(UART_0_INST) || DL_SPI_isBusy(SPI_0_INST)) {
+        return PM_SLEEP;
+    }
+    if (remaining >= PM_STANDBY_MIN_TICKS) return PM_STANDBY;
+    if (remaining >= PM_STOP_MIN_TICKS) return PM_STOP;
+    return PM_SLEEP;
+}
+
+// Sleep in the deepest mode that still wakes in time for deadline
+static void power_idle_until(uint32_t deadline)
+{
+    uint32_t now = systime_now();
+    int32_t remaining = (int32_t)(deadline - now);
+
+    pm_stats.residency[PM_RUN] += now - pm_last_wake;
+    pm_last_wake = now;
+    if (remaining <= 0) return;
+
+    PowerMode mode = power_select_mode((uint32_t)remaining);
+    systime_arm_wakeup(deadline);
+
+    __disable_irq();
+    if (pm_event_pending) {
+        __enable_irq();
+        return;
+    }
+
+    switch (mode) {
+        case PM_STANDBY:
+            DL_SYSCTL_setPowerPolicySTANDBY0();
+            SYSCFG_DL_saveConfiguration();
+            break;
+        case PM_STOP:
+            DL_SYSCTL_setPowerPolicySTOP0();
+            break;
+        default:
+            DL_SYSCTL_setPowerPolicyRUN0SLEEP0();
+            break;
+    }
+
+    // WFI still wakes on a pending IRQ with PRIMASK set
+    __WFI();
+
+    if (mode == PM_STANDBY && !SYSCFG_DL_restoreConfiguration()) {
+        pm_stats.restore_failures++;
+    }
+    DL_SYSCTL_setPowerPolicyRUN0SLEEP0();
+    __enable_irq();
+
+    uint32_t woke = systime_now();
+    pm_stats.residency[mode] += woke - now;
+    pm_stats.entries[mode]++;
+    pm_last_wake = woke;
+
+    // Only timer wakeups have a deadline to be late against
+    if ((int32_t)(woke - deadline) >= 0) {
+        uint32_t late = woke - deadline;
+        if (late > pm_stats.wake_latency_max[mode]) pm_stats.wake_latency_max[mode] = late;
+        pm_stats.wake_latency_sum[mode] += late;
+        pm_stats.wake_count[mode]++;
+    }
+}
+
+// Residency and latency are in LFCLK ticks; the host divides by 32768
+void send_power_stats(void)
+{
+    uart_send_string("{\"frame\":\"power\"");
+    uart_send_field("run", pm_stats.residency[PM_RUN]);
+    uart_send_field("sleep", pm_stats.residency[PM_SLEEP]);
+    uart_send_field("stop", pm_stats.residency[PM_STOP]);
+    uart_send_field("standby", pm_stats.residency[PM_STANDBY]);
+
+    uart_send_field("n_sleep", pm_stats.entries[PM_SLEEP]);
+    uart_send_field("n_stop", pm_stats.entries[PM_STOP]);
+    uart_send_field("n_standby", pm_stats.entries[PM_STANDBY]);
+
+    uart_send_field("lat_max_sleep", pm_stats.wake_latency_max[PM_SLEEP]);
+    uart_send_field("lat_max_stop", pm_stats.wake_latency_max[PM_STOP]);
+    uart_send_field("lat_max_standby", pm_stats.wake_latency_max[PM_STANDBY]);
+    uart_send_field("lat_sum_sleep", pm_stats.wake_latency_sum[PM_SLEEP]);
+    uart_send_field("lat_sum_stop", pm_stats.wake_latency_sum[PM_STOP]);
+    uart_send_field("lat_sum_standby", pm_stats.wake_latency_sum[PM_STANDBY]);
+    uart_send_field("lat_n_sleep", pm_stats.wake_count[PM_SLEEP]);
+    uart_send_field("lat_n_stop", pm_stats.wake_count[PM_STOP]);
+    uart_send_field("lat_n_standby", pm_stats.wake_count[PM_STANDBY]);
+
+    uart_send_field("restore_fail", pm_stats.restore_failures);
+    uart_send_string("}\r\n");
+}
+
+/* ============== TAMPER INPUTS (GPIO/COMP INTERRUPTS) ============== */
+// The cover switch, the reed switch and the light comparator raise an
+// interrupt on every edge instead of waiting for the next base period.
+// The ISR timestamps the edge and appends it to tamper_log. The main loop
+// transmits it at the next service point: the top of the loop, between
+// frames, and between glyphs while drawing. No stage runs longer than one
+// telemetry frame (~30 ms at 115200 baud) between service points.
+//
+// The pin glitch filter only covers 8 ULPCLK cycles, far shorter than
+// contact bounce. So after each edge the source stays masked for
+// TAMPER_DEBOUNCE_MS and is re-read when it is re-armed.
+#define TAMPER_DEBOUNCE_MS        (20)
+#define TAMPER_LATENCY_BUDGET_MS  (100)   // detection-to-transmit target
+#define TAMPER_LOG_SIZE           (16)    // power of two
+
+typedef enum {
+    TAMPER_SRC_COVER = 0,
+    TAMPER_SRC_REED,
+    TAMPER_SRC_LIGHT,
+    TAMPER_SRC_COUNT
+} TamperSource;
+
+typedef struct {
+    uint32_t t;         // systime at ISR entry
+    uint32_t seq;
+    uint8_t src;
+    uint8_t active;
+} TamperEvent;
+
+typedef struct {
+    uint32_t events;        // transmitted
+    uint32_t bounces;       // lockouts that swallowed further edges
+    uint32_t dropped;       // lost to a full log
+    uint32_t lat_last;      // ticks from ISR to last byte on the wire
+    uint32_t lat_max;
+    uint32_t over_budget;
+} TamperStats;
+
+static const char* const tamper_src_name[TAMPER_SRC_COUNT] = {"cover", "reed", "light"};
+
+static volatile TamperEvent tamper_log[TAMPER_LOG_SIZE];
+static volatile uint8_t tamper_head = 0;      // next slot the ISRs write
+static volatile uint8_t tamper_tail = 0;      // next event to transmit
+static volatile uint8_t tamper_level[TAMPER_SRC_COUNT];   // debounced, 1 = tampered
+static volatile uint8_t tamper_masked = 0;    // sources in lockout, one bit each
+static volatile uint32_t tamper_rearm_at[TAMPER_SRC_COUNT];
+static uint32_t tamper_seq = 0;
+static uint16_t tamper_asserts = 0;           // new tamper events not yet seen by main()
+static TamperStats tamper_stats;
+
+static inline uint32_t tamper_pin(uint8_t src)
+{
+    return src == TAMPER_SRC_COVER ? TAMPER_COVER_PIN : TAMPER_REED_PIN;
+}
+
+// Current level, 1 = tampered
+static uint8_t tamper_read(uint8_t src)
+{
+    switch (src) {
+        case TAMPER_SRC_COVER:   // switch opens and the pull-up wins when the cover lifts
+            return DL_GPIO_readPins(TAMPER_PORT, TAMPER_COVER_PIN) ? 1 : 0;
+        case TAMPER_SRC_REED:    // a magnet closes the reed to ground
+            return DL_GPIO_readPins(TAMPER_PORT, TAMPER_REED_PIN) ? 0 : 1;
+        default:                 // light inside the enclosure above the DAC threshold
+            return DL_COMP_getComparatorOutput(COMP_LIGHT_INST) == DL_COMP_COMP_OUTPUT_HIGH;
+    }
+}
+
+// Clears the latched edge and reports whether there was one
+static bool tamper_take_edge(uint8_t src)
+{
+    if (src == TAMPER_SRC_LIGHT) {
+        uint32_t mask = DL_COMP_INTERRUPT_OUTPUT_EDGE | DL_COMP_INTERRUPT_OUTPUT_EDGE_INV;
+        bool edge = DL_COMP_getRawInterruptStatus(COMP_LIGHT_INST, mask) != 0;
+        DL_COMP_clearInterruptStatus(COMP_LIGHT_INST, mask);
+        return edge;
+    }
+    bool edge = DL_GPIO_getRawInterruptStatus(TAMPER_PORT, tamper_pin(src)) != 0;
+    DL_GPIO_clearInterruptStatus(TAMPER_PORT, tamper_pin(src));
+    return edge;
+}
+
+static void tamper_irq_enable(uint8_t src, bool on)
+{
+    if (src == TAMPER_SRC_LIGHT) {
+        uint32_t mask = DL_COMP_INTERRUPT_OUTPUT_EDGE | DL_COMP_INTERRUPT_OUTPUT_EDGE_INV;
+        if (on) DL_COMP_enableInterrupt(COMP_LIGHT_INST, mask);
+        else DL_COMP_disableInterrupt(COMP_LIGHT_INST, mask);
+    } else {
+        if (on) DL_GPIO_enableInterrupt(TAMPER_PORT, tamper_pin(src));
+        else DL_GPIO_disableInterrupt(TAMPER_PORT, tamper_pin(src));
+    }
+}
+
+// ISR context, or main with IRQs off: log a level change and start the lockout
+static void tamper_on_edge(uint8_t src, uint8_t level, uint32_t t)
+{
+    tamper_irq_enable(src, false);
+    tamper_masked |= 1U << src;
+    tamper_rearm_at[src] = t + MS_TO_TICKS(TAMPER_DEBOUNCE_MS);
+    tamper_level[src] = level;
+    pm_event_pending = true;
+
+    uint8_t next = (tamper_head + 1) & (TAMPER_LOG_SIZE - 1);
+    if (next == tamper_tail) {
+        tamper_stats.dropped++;
+        return;
+    }
+    tamper_log[tamper_head].t = t;
+    tamper_log[tamper_head].seq = ++tamper_seq;
+    tamper_log[tamper_head].src = src;
+    tamper_log[tamper_head].active = level;
+    tamper_head = next;
+}
+
+// A switch has two states, so an edge after a stable lockout is a change
+// even if the pin has already bounced back by the time it is read
+void GROUP1_IRQHandler(void)
+{
+    uint32_t t = systime_now();
+
+    switch (DL_Interrupt_getPendingGroup(DL_INTERRUPT_GROUP_1)) {
+        case TAMPER_INT_IIDX: {
+            uint32_t pins = DL_GPIO_getEnabledInterruptStatus(TAMPER_PORT,
+                TAMPER_COVER_PIN | TAMPER_REED_PIN);
+            DL_GPIO_clearInterruptStatus(TAMPER_PORT, pins);
+            if (pins & TAMPER_COVER_PIN) {
+                tamper_on_edge(TAMPER_SRC_COVER, !tamper_level[TAMPER_SRC_COVER], t);
+            }
+            if (pins & TAMPER_REED_PIN) {
+                tamper_on_edge(TAMPER_SRC_REED, !tamper_level[TAMPER_SRC_REED], t);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// The comparator reports the direction; hysteresis and its output filter
+// already keep it from chattering around the threshold
+void COMP_LIGHT_INST_IRQHandler(void)
+{
+    uint32_t t = systime_now();
+
+    switch (DL_COMP_getPendingInterrupt(COMP_LIGHT_INST)) {
+        case DL_COMP_IIDX_OUTPUT_EDGE:
+            tamper_on_edge(TAMPER_SRC_LIGHT, 1, t);
+            break;
+        case DL_COMP_IIDX_OUTPUT_EDGE_INV:
+            tamper_on_edge(TAMPER_SRC_LIGHT, 0, t);
+            break;
+        default:
+            break;
+    }
+}
+
+// End expired lockouts. A level that differs from the logged one changed
+// during the lockout and is logged now, which also restarts the lockout.
+static void tamper_rearm(void)
+{
+    for (uint8_t src = 0; src < TAMPER_SRC_COUNT; src++) {
+        if (!(tamper_masked & (1U << src)) || !systime_reached(tamper_rearm_at[src])) continue;
+
+        __disable_irq();
+        if (tamper_take_edge(src)) tamper_stats.bounces++;
+        uint8_t level = tamper_read(src);
+        if (level != tamper_level[src]) {
+            tamper_on_edge(src, level, systime_now());
+        } else {
+            tamper_masked &= ~(1U << src);
+            // An edge after the read above is latched and fires right away
+            tamper_irq_enable(src, true);
+        }
+        __enable_irq();
+    }
+}
+
+static uint32_t tamper_next_rearm(uint32_t wake)
+{
+    for (uint8_t src = 0; src < TAMPER_SRC_COUNT; src++) {
+        if (tamper_masked & (1U << src)) wake = systime_earliest(wake, tamper_rearm_at[src]);
+    }
+    return wake;
+}
+
+// Tamper frames go out ahead of anything else the loop has queued; the
+// latency covers ISR entry to the frame's last byte leaving the UART
+static void tamper_transmit(void)
+{
+    if (tamper_masked) tamper_rearm();
+
+    while (tamper_tail != tamper_head) {
+        uint8_t i = tamper_tail;
+        uint32_t t = tamper_log[i].t;
+        uint8_t active = tamper_log[i].active;
+
+        frame_mac_begin();
+        uart_send_string("{\"frame\":\"tamper_irq\",\"src\":\"");
+        uart_send_string(tamper_src_name[tamper_log[i].src]);
+        uart_send_char('"');
+        uart_send_device_id();
+        uart_send_field("active", active);
+        uart_send_field("seq", tamper_log[i].seq);
+        uart_send_field("t", t);
+        uart_send_field("queued", systime_now() - t);
+        frame_mac_end();
+        while (DL_UART_isBusy(UART_0_INST));
+
+        uint32_t latency = systime_now() - t;
+        tamper_stats.events++;
+        tamper_stats.lat_last = latency;
+        if (latency > tamper_stats.lat_max) tamper_stats.lat_max = latency;
+        if (latency > MS_TO_TICKS(TAMPER_LATENCY_BUDGET_MS)) tamper_stats.over_budget++;
+        if (active) tamper_asserts++;
+
+        tamper_tail = (i + 1) & (TAMPER_LOG_SIZE - 1);
+    }
+}
+
+// Service point: cheap enough to call per glyph
+static inline void tamper_service(void)
+{
+    if (tamper_masked || tamper_tail != tamper_head) tamper_transmit();
+}
+
+static void tamper_init(void)
+{
+    uint32_t now = systime_now();
+
+    // A cover opened while unpowered is reported at boot
+    for (uint8_t src = 0; src < TAMPER_SRC_COUNT; src++) {
+        tamper_level[src] = 0;
+        if (tamper_read(src)) {
+            __disable_irq();
+            tamper_on_edge(src, 1, now);
+            __enable_irq();
+        }
+    }
+
+    // Tamper edges preempt the time base and UART RX; neither is held off
+    // for more than one short ISR
+    NVIC_SetPriority(TAMPER_INT_IRQN, 0);
+    NVIC_SetPriority(COMP_LIGHT_INST_INT_IRQN, 0);
+    NVIC_SetPriority(TIMER_0_INST_INT_IRQN, 1);
+    NVIC_SetPriority(UART_0_INST_INT_IRQN, 1);
+
+    // Fast wake lets the switches end STANDBY; the ULP comparator runs there
+    DL_GPIO_enableFastWakePins(TAMPER_PORT, TAMPER_COVER_PIN | TAMPER_REED_PIN);
+    NVIC_EnableIRQ(TAMPER_INT_IRQN);
+    NVIC_EnableIRQ(COMP_LIGHT_INST_INT_IRQN);
+}
+
+// Latency in LFCLK ticks; the host divides by 32768
+void send_tamper_stats(void)
+{
+    uart_send_string("{\"frame\":\"tamper\"");
+    uart_send_field("events", tamper_stats.events);
+    uart_send_field("bounces", tamper_stats.bounces);
+    uart_send_field("dropped", tamper_stats.dropped);
+    uart_send_field("lat_last", tamper_stats.lat_last);
+    uart_send_field("lat_max", tamper_stats.lat_max);
+    uart_send_field("over_budget", tamper_stats.over_budget);
+    uart_send_field("budget", MS_TO_TICKS(TAMPER_LATENCY_BUDGET_MS));
+    uart_send_field("level", tamper_level[TAMPER_SRC_COVER] |
+                             (tamper_level[TAMPER_SRC_REED] << 1) |
+                             (tamper_level[TAMPER_SRC_LIGHT] << 2));
+    uart_send_string("}\r\n");
+}
+
 /* ============== SPI FUNCTIONS ============== */
+static uint32_t lcd_spi_bytes = 0;   // every byte sent to the panel, for draw-cost metrics
+
 static inline void spi_tx(uint8_t b)
 {
     DL_SPI_fillTXFIFO8(SPI_0_INST, &b, 1);
     while (DL_SPI_isBusy(SPI_0_INST));
+    lcd_spi_bytes++;
 }
 
 /* ============== LCD PRIMITIVES ============== */
@@ -153,27 +751,6 @@ static void lcd_data(uint8_t d)
     spi_tx(d);
 }
 
-static void lcd_reset(void)
-{
-    RST_LOW();
-    delay_ms(20);
-    RST_HIGH();
-    delay_ms(150);
-}
-
-static void ili9341_init(void)
-{
-    lcd_reset();
-    lcd_cmd(0x11);
-    delay_ms(120);
-    lcd_cmd(0x3A);
-    lcd_data(0x55);
-    lcd_cmd(0x36);
-    lcd_data(0xC8);
-    lcd_cmd(0x29);
-    delay_ms(20);
-}
-
 static void lcd_set_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
 {
     lcd_cmd(0x2A);
@@ -194,24 +771,70 @@ static void lcd_draw_pixel(uint16_t x, uint16_t y, uint16_t color)
     spi_tx(color & 0xFF);
 }
 
-static void lcd_fill(uint16_t color)
+static void lcd_fill_rect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color)
 {
-    lcd_set_window(0, 0, 239, 319);
+    lcd_set_window(x, y, x+w-1, y+h-1);
     DC_HIGH();
-    for (uint32_t i = 0; i < 76800; i++) {
+    for (uint32_t i = 0; i < (uint32_t)w * h; i++) {
         spi_tx(color >> 8);
         spi_tx(color & 0xFF);
     }
 }
 
-static void lcd_fill_rect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color)
+/* ============== LCD BRING-UP (NON-BLOCKING) ============== */
+typedef enum {
+    LCD_RESET_ASSERT = 0,
+    LCD_RESET_RELEASE,
+    LCD_SLEEP_OUT,
+    LCD_CONFIGURE,
+    LCD_DISPLAY_ON,
+    LCD_READY
+} LcdState;
+
+static LcdState lcd_state = LCD_RESET_ASSERT;
+static uint32_t lcd_deadline = 0;
+
+// Runs the ILI9341 power-up sequence one step per call instead of
+// blocking ~290 ms; returns true once the panel accepts pixel data
+static bool ili9341_init_step(void)
 {
-    lcd_set_window(x, y, x+w-1, y+h-1);
-    DC_HIGH();
-    for (uint32_t i = 0; i < (uint32_t)w * h; i++) {
-        spi_tx(color >> 8);
-        spi_tx(color & 0xFF);
+    if (lcd_state == LCD_READY) return true;
+    if (!systime_reached(lcd_deadline)) return false;
+
+    uint32_t now = systime_now();
+
+    switch (lcd_state) {
+        case LCD_RESET_ASSERT:
+            RST_LOW();
+            lcd_deadline = now + MS_TO_TICKS(20);
+            lcd_state = LCD_RESET_RELEASE;
+            break;
+        case LCD_RESET_RELEASE:
+            RST_HIGH();
+            lcd_deadline = now + MS_TO_TICKS(150);
+            lcd_state = LCD_SLEEP_OUT;
+            break;
+        case LCD_SLEEP_OUT:
+            lcd_cmd(0x11);
+            lcd_deadline = now + MS_TO_TICKS(120);
+            lcd_state = LCD_CONFIGURE;
+            break;
+        case LCD_CONFIGURE:
+            lcd_cmd(0x3A);
+            lcd_data(0x55);
+            lcd_cmd(0x36);
+            lcd_data(0xC8);
+            lcd_cmd(0x29);
+            lcd_deadline = now + MS_TO_TICKS(20);
+            lcd_state = LCD_DISPLAY_ON;
+            break;
+        case LCD_DISPLAY_ON:
+            lcd_state = LCD_READY;
+            return true;
+        default:
+            break;
     }
+    return false;
 }
 
 /* ============== 5x7 FONT (EXTENDED WITH l AND x) ============== */
@@ -300,6 +923,7 @@ static void lcd_draw_string(uint16_t x, uint16_t y, const char* str, uint16_t co
 {
     uint16_t offset = 0;
     while (*str) {
+        tamper_service();
         lcd_draw_char(x + offset, y, *str, color, size);
         offset += 6 * size;
         str++;
@@ -308,8 +932,8 @@ static void lcd_draw_string(uint16_t x, uint16_t y, const char* str, uint16_t co
 
 static void lcd_draw_number(uint16_t x, uint16_t y, uint16_t num, uint16_t color, uint8_t size)
 {
-    char buffer[6];
-    int_to_string(num, buffer);
+    char buffer[FMT_U32_MAX];
+    fmt_u32(buffer, num);
     lcd_draw_string(x, y, buffer, color, size);
 }
 
@@ -340,88 +964,1018 @@ static void draw_status_icon(uint16_t x, uint16_t y, bool is_ok)
     }
 }
 
-/* ============== DISPLAY SCREEN ============== */
-static void display_meter_screen(uint8_t is_tamper, uint16_t voltage, uint16_t curr, uint16_t temp, 
-                                  uint16_t light, uint16_t mag, uint16_t events, DateTime* last_dt)
+/* ============== DISPLAY SCREEN (INCREMENTAL) ============== */
+// The screen is painted one phase per main-loop pass so a redraw never
+// stalls sampling for more than a single band or text row
+#define SCREEN_BG_BANDS   (10)
+#define SCREEN_BG_HEIGHT  (190)   // the trend pane owns 190..269
+
+enum {
+    SCREEN_IDLE = 0,
+    SCREEN_BACKGROUND,
+    SCREEN_HEADER = SCREEN_BACKGROUND + SCREEN_BG_BANDS,
+    SCREEN_TIMESTAMP,
+    SCREEN_VOLTAGE,
+    SCREEN_CURRENT,
+    SCREEN_TEMPERATURE,
+    SCREEN_LIGHT,
+    SCREEN_MAGNETIC,
+    SCREEN_EVENTS,
+    SCREEN_ICON,
+    SCREEN_FOOTER,
+    SCREEN_DONE
+};
+
+typedef struct {
+    uint8_t is_tamper;
+    uint16_t voltage;
+    uint16_t curr;
+    uint16_t temp;
+    uint16_t light;
+    uint16_t mag;
+    uint16_t events;
+    DateTime last_dt;
+} ScreenData;
+
+static ScreenData screen_data;
+static ScreenData screen_pending;
+static bool screen_has_pending = false;
+static uint8_t screen_phase = SCREEN_IDLE;
+static bool display_paused = false;
+
+static void draw_reading_row(uint16_t y, const char* label, uint16_t value, const char* unit)
 {
-    uint16_t bg_color = is_tamper ? BG_RED_LIGHT : BG_GREEN_LIGHT;
-    const char* status_text = is_tamper ? "TAMPERING" : "NORMAL";
-    
-    lcd_fill(bg_color);
-    
-    lcd_draw_string(40, 8, "LATEST TAMPER", TEXT_BLACK, 2);
-    
-    char date_str[11];
-    date_str[0] = (last_dt->day / 10) + '0';
-    date_str[1] = (last_dt->day % 10) + '0';
-    date_str[2] = '/';
-    date_str[3] = (last_dt->month / 10) + '0';
-    date_str[4] = (last_dt->month % 10) + '0';
-    date_str[5] = '/';
-    date_str[6] = ((last_dt->year / 1000) % 10) + '0';
-    date_str[7] = ((last_dt->year / 100) % 10) + '0';
-    date_str[8] = ((last_dt->year / 10) % 10) + '0';
-    date_str[9] = (last_dt->year % 10) + '0';
-    date_str[10] = '\0';
-    lcd_draw_string(60, 28, date_str, TEXT_BLACK, 2);
-    
-    char time_str[9];
-    time_str[0] = (last_dt->hour / 10) + '0';
-    time_str[1] = (last_dt->hour % 10) + '0';
-    time_str[2] = ':';
-    time_str[3] = (last_dt->minute / 10) + '0';
-    time_str[4] = (last_dt->minute % 10) + '0';
-    time_str[5] = ':';
-    time_str[6] = (last_dt->second / 10) + '0';
-    time_str[7] = (last_dt->second % 10) + '0';
-    time_str[8] = '\0';
-    lcd_draw_string(72, 46, time_str, TEXT_BLACK, 2);
-    
-    lcd_fill_rect(10, 64, 220, 2, TEXT_BLACK);
-    
-    // Voltage
-    lcd_draw_string(10, 75, "V :  ", TEXT_BLACK, 2);
-    lcd_draw_number(52, 75, voltage, TEXT_BLACK, 2);
-    lcd_draw_string(88, 75, " V", TEXT_BLACK, 2);
-    
-    // Current
-    lcd_draw_string(10, 105, "I :  ", TEXT_BLACK, 2);
-    lcd_draw_number(52, 105, curr, TEXT_BLACK, 2);
-    lcd_draw_string(88, 105, " A", TEXT_BLACK, 2);
-    
-    // Temperature
-    lcd_draw_string(10, 135, "T :  ", TEXT_BLACK, 2);
-    lcd_draw_number(52, 135, temp, TEXT_BLACK, 2);
-    lcd_draw_string(88, 135, " C", TEXT_BLACK, 2);
-    
-    // Light with proper lx
-    lcd_draw_string(10, 165, "L :  ", TEXT_BLACK, 2);
-    lcd_draw_number(52, 165, light, TEXT_BLACK, 2);
-    lcd_draw_string(88, 165, " lx", TEXT_BLACK, 2);
-    
-    // Magnetic
-    lcd_draw_string(10, 195, "M :  ", TEXT_BLACK, 2);
-    lcd_draw_number(52, 195, mag, TEXT_BLACK, 2);
-    lcd_draw_string(88, 195, " T", TEXT_BLACK, 2);
-    
-    // Events
-    lcd_draw_string(10, 225, "E :  ", TEXT_BLACK, 2);
-    lcd_draw_number(52, 225, events, TEXT_BLACK, 2);
-    
-    draw_status_icon(160, 110, !is_tamper);
-    
-    lcd_fill_rect(0, 270, 240, 50, BLACK);
-    lcd_draw_string(is_tamper ? 12 : 48, 283, status_text, TEXT_WHITE, 4);
+    lcd_draw_string(10, y, label, TEXT_BLACK, 2);
+    lcd_draw_number(52, y, value, TEXT_BLACK, 2);
+    if (unit) lcd_draw_string(88, y, unit, TEXT_BLACK, 2);
 }
 
+static void display_meter_screen_phase(const ScreenData* s, uint8_t phase)
+{
+    uint16_t bg_color = s->is_tamper ? BG_RED_LIGHT : BG_GREEN_LIGHT;
+    const DateTime* last_dt = &s->last_dt;
+
+    if (phase >= SCREEN_BACKGROUND && phase < SCREEN_HEADER) {
+        uint16_t band_h = SCREEN_BG_HEIGHT / SCREEN_BG_BANDS;
+        lcd_fill_rect(0, (phase - SCREEN_BACKGROUND) * band_h, 240, band_h, bg_color);
+        return;
+    }
+
+    switch (phase) {
+        case SCREEN_HEADER:
+            lcd_draw_string(40, 8, "LATEST TAMPER", TEXT_BLACK, 2);
+            break;
+
+        case SCREEN_TIMESTAMP: {
+            // DD/MM/YYYY and HH:MM:SS; each field NUL-terminates, the
+            // separator overwrites it
+            char date_str[11];
+            fmt_u32_width(&date_str[0], last_dt->day, 2, '0');
+            date_str[2] = '/';
+            fmt_u32_width(&date_str[3], last_dt->month, 2, '0');
+            date_str[5] = '/';
+            fmt_u32_width(&date_str[6], last_dt->year, 4, '0');
+            lcd_draw_string(60, 28, date_str, TEXT_BLACK, 2);
+
+            char time_str[9];
+            fmt_u32_width(&time_str[0], last_dt->hour, 2, '0');
+            time_str[2] = ':';
+            fmt_u32_width(&time_str[3], last_dt->minute, 2, '0');
+            time_str[5] = ':';
+            fmt_u32_width(&time_str[6], last_dt->second, 2, '0');
+            lcd_draw_string(72, 46, time_str, TEXT_BLACK, 2);
+
+            lcd_fill_rect(10, 64, 220, 2, TEXT_BLACK);
+            break;
+        }
+
+        case SCREEN_VOLTAGE:     draw_reading_row(72, "V :  ", s->voltage, " V"); break;
+        case SCREEN_CURRENT:     draw_reading_row(92, "I :  ", s->curr, " A"); break;
+        case SCREEN_TEMPERATURE: draw_reading_row(112, "T :  ", s->temp, " C"); break;
+        case SCREEN_LIGHT:       draw_reading_row(132, "L :  ", s->light, " lx"); break;
+        case SCREEN_MAGNETIC:    draw_reading_row(152, "M :  ", s->mag, " T"); break;
+        case SCREEN_EVENTS:      draw_reading_row(172, "E :  ", s->events, 0); break;
+
+        case SCREEN_ICON:
+            draw_status_icon(160, 80, !s->is_tamper);
+            break;
+
+        case SCREEN_FOOTER:
+            lcd_fill_rect(0, 270, 240, 50, BLACK);
+            lcd_draw_string(s->is_tamper ? 12 : 48, 283, s->is_tamper ? "TAMPERING" : "NORMAL", TEXT_WHITE, 4);
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Queue a full redraw; a newer request replaces one not yet started
+static void display_meter_screen(uint8_t is_tamper, uint16_t voltage, uint16_t curr, uint16_t temp,
+                                  uint16_t light, uint16_t mag, uint16_t events, DateTime* last_dt)
+{
+    screen_pending.is_tamper = is_tamper;
+    screen_pending.voltage = voltage;
+    screen_pending.curr = curr;
+    screen_pending.temp = temp;
+    screen_pending.light = light;
+    screen_pending.mag = mag;
+    screen_pending.events = events;
+    screen_pending.last_dt = *last_dt;
+    screen_has_pending = true;
+}
+
+// Paints one phase; returns true while a redraw is still in progress
+static bool display_step(void)
+{
+    if (screen_phase == SCREEN_IDLE) {
+        if (!screen_has_pending || display_paused) return false;
+        screen_data = screen_pending;
+        screen_has_pending = false;
+        screen_phase = SCREEN_BACKGROUND;
+    }
+
+    display_meter_screen_phase(&screen_data, screen_phase);
+
+    if (++screen_phase == SCREEN_DONE) {
+        screen_phase = SCREEN_IDLE;
+    }
+    return screen_phase != SCREEN_IDLE || screen_has_pending;
+}
+
+/* ============== TREND PANE (HARDWARE SCROLL) ============== */
+// Voltage and current strip chart between the readings and the footer.
+// The pane is the ILI9341 vertical scroll area: each sample moves the
+// scroll start address by one line (0x37) and rewrites only that line,
+// so the cost per sample is a few short spans, never a repaint.
+//
+// Scrolling works in frame-memory lines. MADCTL MY=1 (0x36 = 0xC8) puts
+// page address y on memory line 319 - y, so the footer is the top fixed
+// area and the readings above the pane are the bottom fixed area. With
+// this mapping the newest sample appears on the pane's top line and
+// history flows down.
+#define TREND_LABEL_Y    (190)
+#define TREND_Y0         (206)   // first display row of the pane
+#define TREND_H          (64)    // scroll area lines = samples of history
+#define TREND_TFA        (320 - TREND_Y0 - TREND_H)   // footer, fixed
+#define TREND_BFA        (TREND_Y0)                   // readings, fixed
+#define TREND_LANE_W     (120)
+#define TREND_PLOT_X     (2)     // plot area inside each lane
+#define TREND_PLOT_W     (116)
+#define TREND_INIT_BANDS (4)
+
+// Lane scaling is multiply + shift (no divide): span 64 V and 128 A
+#define TREND_V_MIN      (200)
+#define TREND_V_SHIFT    (6)
+#define TREND_I_SHIFT    (7)
+#define TREND_V_REF      (230)   // nominal supply, drawn as a reference column
+#define TREND_I_REF      (40)    // current channel's adaptive threshold
+
+#define TREND_BG         BLACK
+#define TREND_GRID       0x4208
+#define TREND_V_COLOR    0x07E0
+#define TREND_I_COLOR    0xFFE0
+#define TREND_TAMPER     0x001F
+
+#define TREND_REPAINT_BYTES  (11U + 2U * 240U * TREND_H)   // full-pane redraw, for comparison
+
+enum {
+    TREND_OFF = 0,
+    TREND_LABELS,
+    TREND_BANDS,
+    TREND_GRIDLINES = TREND_BANDS + TREND_INIT_BANDS,
+    TREND_LIVE
+};
+
+typedef struct {
+    uint32_t samples;
+    uint32_t bytes_total;    // SPI bytes spent on samples, scroll command included
+    uint32_t bytes_last;
+    uint32_t bytes_max;
+    uint32_t init_bytes;     // one-time pane setup
+    uint32_t cycles_max;
+} TrendStats;
+
+static TrendStats trend_stats;
+static uint8_t trend_phase = TREND_OFF;
+static uint8_t trend_line = 0;                // scroll offset into the area
+static uint8_t trend_span[TREND_H][2][2];     // drawn [lo, hi] per memory line and lane; lo > hi = empty
+static uint8_t trend_prev[2];
+static bool trend_have_prev = false;
+
+static inline uint8_t trend_x_voltage(uint16_t v)
+{
+    if (v <= TREND_V_MIN) return 0;
+    uint32_t x = ((uint32_t)(v - TREND_V_MIN) * TREND_PLOT_W) >> TREND_V_SHIFT;
+    return x >= TREND_PLOT_W ? TREND_PLOT_W - 1 : (uint8_t)x;
+}
+
+static inline uint8_t trend_x_current(uint16_t a)
+{
+    uint32_t x = ((uint32_t)a * TREND_PLOT_W) >> TREND_I_SHIFT;
+    return x >= TREND_PLOT_W ? TREND_PLOT_W - 1 : (uint8_t)x;
+}
+
+static void trend_set_scroll(uint16_t ssa)
+{
+    lcd_cmd(0x37);
+    lcd_data(ssa >> 8); lcd_data(ssa & 0xFF);
+}
+
+// Paints the label strip, the pane and its gridlines one phase per call
+// once the first screen is up; returns true while setup is in progress
+static bool trend_init_step(void)
+{
+    if (trend_phase == TREND_LIVE) return false;
+    uint32_t bytes_before = lcd_spi_bytes;
+
+    if (trend_phase == TREND_OFF) {
+        trend_phase = TREND_LABELS;
+    }
+
+    if (trend_phase == TREND_LABELS) {
+        lcd_fill_rect(0, TREND_LABEL_Y, 240, TREND_Y0 - TREND_LABEL_Y, TREND_BG);
+        lcd_draw_string(4, TREND_LABEL_Y + 4, "V 200 TO 264", TREND_V_COLOR, 1);
+        lcd_draw_string(TREND_LANE_W + 4, TREND_LABEL_Y + 4, "I 0 TO 128 A", TREND_I_COLOR, 1);
+    } else if (trend_phase < TREND_GRIDLINES) {
+        uint16_t band_h = TREND_H / TREND_INIT_BANDS;
+        lcd_fill_rect(0, TREND_Y0 + (trend_phase - TREND_BANDS) * band_h, 240, band_h, TREND_BG);
+    } else {
+        uint8_t v_ref = TREND_PLOT_X + trend_x_voltage(TREND_V_REF);
+        uint8_t i_ref = TREND_LANE_W + TREND_PLOT_X + trend_x_current(TREND_I_REF);
+        lcd_fill_rect(TREND_LANE_W - 1, TREND_Y0, 1, TREND_H, TREND_GRID);
+        lcd_fill_rect(v_ref, TREND_Y0, 1, TREND_H, TREND_GRID);
+        lcd_fill_rect(i_ref, TREND_Y0, 1, TREND_H, TREND_GRID);
+
+        for (uint8_t line = 0; line < TREND_H; line++) {
+            for (uint8_t lane = 0; lane < 2; lane++) {
+                trend_span[line][lane][0] = 1;
+                trend_span[line][lane][1] = 0;
+            }
+        }
+
+        // Vertical scrolling definition: top fixed, scroll area, bottom fixed
+        lcd_cmd(0x33);
+        lcd_data(TREND_TFA >> 8); lcd_data(TREND_TFA & 0xFF);
+        lcd_data(TREND_H >> 8);   lcd_data(TREND_H & 0xFF);
+        lcd_data(TREND_BFA >> 8); lcd_data(TREND_BFA & 0xFF);
+        trend_set_scroll(TREND_TFA);
+        trend_line = 0;
+    }
+
+    trend_stats.init_bytes += lcd_spi_bytes - bytes_before;
+    trend_phase++;
+    return trend_phase != TREND_LIVE;
+}
+
+// Rewrites the union of the span drawn on this line last time round and
+// the new one: the old trace is erased and the new one drawn in one window
+static void trend_draw_span(uint16_t y, uint8_t lane, uint8_t* drawn, uint8_t lo, uint8_t hi,
+                            uint8_t ref, uint16_t color)
+{
+    uint8_t x0 = lo, x1 = hi;
+    if (drawn[0] <= drawn[1]) {
+        if (drawn[0] < x0) x0 = drawn[0];
+        if (drawn[1] > x1) x1 = drawn[1];
+    }
+    uint16_t base = lane * TREND_LANE_W + TREND_PLOT_X;
+
+    lcd_set_window(base + x0, y, base + x1, y);
+    DC_HIGH();
+    for (uint8_t x = x0; x <= x1; x++) {
+        uint16_t c = (x >= lo && x <= hi) ? color : (x == ref ? TREND_GRID : TREND_BG);
+        spi_tx(c >> 8);
+        spi_tx(c & 0xFF);
+    }
+    drawn[0] = lo;
+    drawn[1] = hi;
+}
+
+// One sample = one new line of the strip chart
+static void trend_push(uint16_t voltage, uint16_t current, bool tamper)
+{
+    if (trend_phase != TREND_LIVE || display_paused) return;
+
+    uint32_t start = cycle_now();
+    uint32_t bytes_before = lcd_spi_bytes;
+    uint8_t x[2] = {trend_x_voltage(voltage), trend_x_current(current)};
+    static const uint16_t lane_color[2] = {TREND_V_COLOR, TREND_I_COLOR};
+    uint8_t ref[2] = {trend_x_voltage(TREND_V_REF), trend_x_current(TREND_I_REF)};
+
+    // Recycle the oldest line: scroll it to the top, then overwrite it
+    uint16_t mem_line = TREND_TFA + trend_line;
+    if (++trend_line == TREND_H) trend_line = 0;
+    trend_set_scroll(TREND_TFA + trend_line);
+
+    uint16_t y = 319 - mem_line;
+    for (uint8_t lane = 0; lane < 2; lane++) {
+        // Join to the previous sample so steps read as a continuous trace
+        uint8_t lo = x[lane], hi = x[lane];
+        if (trend_have_prev) {
+            if (trend_prev[lane] < lo) lo = trend_prev[lane];
+            if (trend_prev[lane] > hi) hi = trend_prev[lane];
+        }
+        trend_draw_span(y, lane, trend_span[mem_line - TREND_TFA][lane], lo, hi, ref[lane],
+                        tamper ? TREND_TAMPER : lane_color[lane]);
+        trend_prev[lane] = x[lane];
+    }
+    trend_have_prev = true;
+
+    uint32_t bytes = lcd_spi_bytes - bytes_before;
+    uint32_t cycles = cycles_since(start);
+    trend_stats.samples++;
+    trend_stats.bytes_total += bytes;
+    trend_stats.bytes_last = bytes;
+    if (bytes > trend_stats.bytes_max) trend_stats.bytes_max = bytes;
+    if (cycles > trend_stats.cycles_max) trend_stats.cycles_max = cycles;
+}
+
+void send_trend_stats(void)
+{
+    uart_send_string("{\"frame\":\"trend\"");
+    uart_send_field("samples", trend_stats.samples);
+    uart_send_field("bytes", trend_stats.bytes_total);
+    uart_send_field("last", trend_stats.bytes_last);
+    uart_send_field("max", trend_stats.bytes_max);
+    uart_send_field("repaint", TREND_REPAINT_BYTES);
+    uart_send_field("init", trend_stats.init_bytes);
+    uart_send_field("cycles_max", trend_stats.cycles_max);
+    uart_send_string("}\r\n");
+}
+
+/* ============== BOOT METRICS ============== */
+typedef struct {
+    uint32_t first_sample;   // ticks from timer start to first telemetry frame
+    uint32_t lcd_ready;      // panel bring-up complete
+    uint32_t first_screen;   // first full screen painted
+    bool reported;
+} BootStats;
+
+static BootStats boot_stats;
+
+void send_boot_stats(void)
+{
+    uart_send_string("{\"frame\":\"boot\"");
+    uart_send_device_id();
+    uart_send_field("first_sample", boot_stats.first_sample);
+    uart_send_field("lcd_ready", boot_stats.lcd_ready);
+    uart_send_field("first_screen", boot_stats.first_screen);
+    uart_send_string("}\r\n");
+}
+
+/* ============== SENSOR CHANNELS & ADAPTIVE SAMPLING ============== */
+typedef enum {
+    CH_VOLTAGE = 0,
+    CH_CURRENT,
+    CH_TEMP,
+    CH_LIGHT,
+    CH_MAG,
+    CH_COUNT
+} SensorChannel;
+
+#define PERIOD_MIN_MS       (50)
+#define PERIOD_MAX_MS       (60000)
+#define FAST_PERIOD_MS      (250)     // adaptive rate near a threshold
+#define BURST_PERIOD_MS     (100)     // host-requested burst rate
+#define ADAPT_HOLD_MS       (10000)   // stay fast this long after the last hot reading
+
+typedef struct {
+    uint16_t period_ms;      // base period, set by host
+    uint16_t threshold;      // anomaly threshold, 0 = not adaptive
+    uint32_t next_due;
+    uint32_t fast_until;     // adaptive fast rate expires here
+    uint16_t value;
+} SampleChannel;
+
+static SampleChannel channels[CH_COUNT] = {
+    [CH_VOLTAGE] = {DELAY, 0,   0, 0, 0},
+    [CH_CURRENT] = {DELAY, 40,  0, 0, 0},
+    [CH_TEMP]    = {DELAY, 38,  0, 0, 0},
+    [CH_LIGHT]   = {DELAY, 100, 0, 0, 0},
+    [CH_MAG]     = {DELAY, 40,  0, 0, 0},
+};
+
+static uint32_t burst_until = 0;
+static bool burst_active = false;
+
+typedef struct {
+    uint32_t frames_sent;
+    uint32_t escalations;    // channel switched to the fast rate
+    uint32_t cmd_ok;
+    uint32_t cmd_errors;
+    uint32_t rx_overflow;
+    uint32_t captures;
+    uint32_t captures_dropped;   // trigger while a capture was in flight
+} LinkStats;
+
+static LinkStats link_stats;
+
+// Simulated sensor front end
+static uint16_t sensor_read(uint8_t ch, bool tamper)
+{
+    switch (ch) {
+        case CH_VOLTAGE: return random_range(230, 240);
+        case CH_CURRENT: return tamper ? random_range(50, 150) : random_range(1, 15);
+        case CH_TEMP:    return tamper ? random_range(40, 60) : random_range(20, 35);
+        case CH_LIGHT:   return tamper ? random_range(150, 250) : random_range(0, 30);
+        case CH_MAG:     return tamper ? random_range(80, 150) : random_range(0, 10);
+        default:         return 0;
+    }
+}
+
+static uint32_t channel_period_ticks(const SampleChannel* c, uint32_t now)
+{
+    if (burst_active) return MS_TO_TICKS(BURST_PERIOD_MS);
+    if ((int32_t)(c->fast_until - now) > 0 && c->period_ms > FAST_PERIOD_MS) {
+        return MS_TO_TICKS(FAST_PERIOD_MS);
+    }
+    return MS_TO_TICKS(c->period_ms);
+}
+
+// Readings within 75% of a threshold (or past it) switch the channel to
+// the fast rate; it drops back once quiet for ADAPT_HOLD_MS
+static void adapt_channel(SampleChannel* c, uint32_t now)
+{
+    if (c->threshold == 0) return;
+    if ((uint32_t)c->value * 4U < (uint32_t)c->threshold * 3U) return;
+
+    if ((int32_t)(c->fast_until - now) <= 0) {
+        link_stats.escalations++;
+        c->next_due = now + MS_TO_TICKS(FAST_PERIOD_MS);
+    }
+    c->fast_until = now + MS_TO_TICKS(ADAPT_HOLD_MS);
+}
+
+// Samples every channel that is due; returns true if any was sampled
+static bool sample_due_channels(bool tamper)
+{
+    uint32_t now = systime_now();
+    bool sampled = false;
+
+    if (burst_active && (int32_t)(now - burst_until) >= 0) {
+        burst_active = false;
+    }
+
+    for (uint8_t ch = 0; ch < CH_COUNT; ch++) {
+        SampleChannel* c = &channels[ch];
+        if ((int32_t)(now - c->next_due) < 0) continue;
+
+        c->value = sensor_read(ch, tamper);
+        c->next_due += channel_period_ticks(c, now);
+        if ((int32_t)(now - c->next_due) >= 0) {
+            c->next_due = now + channel_period_ticks(c, now);  // fell behind, resync
+        }
+        adapt_channel(c, now);
+        sampled = true;
+    }
+    return sampled;
+}
+
+static uint32_t next_channel_due(void)
+{
+    uint32_t due = channels[0].next_due;
+    for (uint8_t ch = 1; ch < CH_COUNT; ch++) {
+        if ((int32_t)(channels[ch].next_due - due) < 0) due = channels[ch].next_due;
+    }
+    return due;
+}
+
+/* ============== HARMONIC ANALYSIS ============== */
+// One line cycle of current, FFT_N samples, analysed on every current sample.
+// Must finish well inside one 50 Hz cycle so it can run back to back.
+#define HARM_BUDGET_CYCLES  (CPUCLK_FREQ / 50)
+#define HARM_COUNTS_PER_A   (150)     // simulated CT scaling, 150 A -> 22500 counts
+
+typedef struct {
+    uint32_t runs;
+    uint32_t cycles_last;
+    uint32_t cycles_max;
+    uint32_t over_budget;
+} HarmonicStats;
+
+static HarmonicStats harm_stats;
+static HarmonicFeatures harm_features;
+static int16_t harm_window[FFT_N];     // last analysed cycle, also kept by the capture ring
+
+// Simulated CT waveform: a clean load is nearly sinusoidal; a rectifier
+// bypass adds odd harmonics and a saturating CT (strong external magnet)
+// adds even ones. The harmonic amplitudes are derived from the tamper flag
+// and the magnetic threshold, so THD and h1..h8 restate flags the frame
+// already carries; frames say so with "hsim":1 (HARM_SIMULATED) and the
+// host does not count them as evidence until a real CT window is sampled.
+static void synth_current_cycle(int16_t* out, uint16_t amps, bool tamper, uint16_t mag_field)
+{
+    int32_t a1 = (int32_t)amps * HARM_COUNTS_PER_A;
+    int32_t a2 = mag_field > channels[CH_MAG].threshold ? a1 / 4 : 0;
+    int32_t a3 = tamper ? a1 * 3 / 10 : a1 / 50;
+    int32_t a5 = tamper ? a1 / 5 : 0;
+    int32_t a7 = tamper ? a1 / 10 : 0;
+
+    for (uint16_t n = 0; n < FFT_N; n++) {
+        int32_t x = a1 * sin_q15_lookup(n)
+                  + a2 * sin_q15_lookup(2 * n)
+                  + a3 * sin_q15_lookup(3 * n)
+                  + a5 * sin_q15_lookup(5 * n)
+                  + a7 * sin_q15_lookup(7 * n);
+        x = (x >> 15) + (int32_t)random_range(0, 40) - 20;
+        if (x > 32767) x = 32767;
+        if (x < -32768) x = -32768;
+        out[n] = (int16_t)x;
+    }
+}
+
+static const HarmonicFeatures* harmonic_update(uint16_t amps, bool tamper, uint16_t mag_field)
+{
+    synth_current_cycle(harm_window, amps, tamper, mag_field);
+
+    uint32_t start = cycle_now();
+    harmonic_analyze(harm_window, &harm_features);
+    uint32_t cycles = cycles_since(start);
+
+    harm_stats.runs++;
+    harm_stats.cycles_last = cycles;
+    if (cycles > harm_stats.cycles_max) harm_stats.cycles_max = cycles;
+    if (cycles > HARM_BUDGET_CYCLES) harm_stats.over_budget++;
+    return &harm_features;
+}
+
+/* ============== WAVEFORM CAPTURE ============== */
+// Every analysed line cycle of current (FFT_N samples at 50 * FFT_N Hz) is
+// recorded into an SRAM ring together with the channel values of its
+// frame. Cycles are one per current sample, not back to back: the front
+// end only digitises a cycle when the current channel is sampled. A tamper
+// trigger copies cap_pre cycles before it and cap_post from it onwards
+// into a second buffer, which is streamed to the host in small chunks
+// between samples. The ring keeps recording meanwhile, so a tamper right
+// after a capture still has its pre-trigger history.
+#define CAPTURE_DEPTH        (16)   // power of two; 2 x 2.3 KB of SRAM with cap_out
+#define CAPTURE_PRE_DEFAULT  (12)
+#define CAPTURE_CHUNK        (1)    // records per telemetry line
+#define CAPTURE_CHUNK_MS     (80)   // pacing between chunks
+#define CAPTURE_CHUNK_TX_MS  (70)   // worst-case UART time for one signed chunk (~630 B) plus capture_start
+
+typedef struct {
+    uint32_t t;
+    uint16_t v[CH_COUNT];
+    int16_t w[FFT_N];               // current waveform, CT counts
+} CaptureRecord;
+
+typedef enum {
+    CAP_IDLE = 0,
+    CAP_POST_TRIGGER,
+    CAP_STREAMING
+} CaptureState;
+
+static CaptureRecord cap_buf[CAPTURE_DEPTH];    // recording ring, never paused
+static CaptureRecord cap_out[CAPTURE_DEPTH];    // frozen window being streamed
+static CaptureState cap_state = CAP_IDLE;
+static uint16_t cap_head = 0;       // next slot to write
+static uint16_t cap_count = 0;      // valid records in the ring
+static uint16_t cap_pre = CAPTURE_PRE_DEFAULT;
+static uint16_t cap_post = CAPTURE_DEPTH - CAPTURE_PRE_DEFAULT;
+static uint16_t cap_post_left = 0;
+static uint16_t cap_trigger = 0;    // trigger offset within the window
+static uint16_t cap_len = 0;
+static uint16_t cap_sent = 0;       // records streamed so far
+static uint16_t cap_id = 0;
+static uint32_t cap_seq = 0;        // capture frames sent this boot, for the host's replay check
+static uint32_t cap_next_chunk = 0;
+
+static inline bool capture_streaming(void)
+{
+    return cap_state == CAP_STREAMING;
+}
+
+// Arms a capture; returns its id, or 0 if one is still in flight
+static uint16_t capture_trigger(void)
+{
+    if (cap_state != CAP_IDLE) {
+        link_stats.captures_dropped++;
+        return 0;
+    }
+    cap_trigger = cap_count < cap_pre ? cap_count : cap_pre;
+    cap_post_left = cap_post;
+    cap_state = CAP_POST_TRIGGER;
+    if (++cap_id == 0) cap_id = 1;
+    link_stats.captures++;
+    return cap_id;
+}
+
+static void capture_record(uint32_t t, const int16_t* wave)
+{
+    CaptureRecord* r = &cap_buf[cap_head];
+    r->t = t;
+    for (uint8_t ch = 0; ch < CH_COUNT; ch++) {
+        r->v[ch] = channels[ch].value;
+    }
+    for (uint16_t i = 0; i < FFT_N; i++) {
+        r->w[i] = wave[i];
+    }
+    cap_head = (cap_head + 1) & (CAPTURE_DEPTH - 1);
+    if (cap_count < CAPTURE_DEPTH) cap_count++;
+
+    if (cap_state == CAP_POST_TRIGGER && --cap_post_left == 0) {
+        cap_len = cap_trigger + cap_post;
+        uint16_t start = (cap_head - cap_len) & (CAPTURE_DEPTH - 1);
+        for (uint16_t k = 0; k < cap_len; k++) {
+            cap_out[k] = cap_buf[(start + k) & (CAPTURE_DEPTH - 1)];
+        }
+        cap_sent = 0;
+        cap_next_chunk = t;
+        cap_state = CAP_STREAMING;
+    }
+}
+
+static bool capture_configure(uint16_t pre, uint16_t post)
+{
+    if (cap_state != CAP_IDLE) return false;
+    if (post == 0 || (uint32_t)pre + post > CAPTURE_DEPTH) return false;
+    cap_pre = pre;
+    cap_post = post;
+    return true;
+}
+
+static void capture_send_chunk(uint16_t first, uint16_t n)
+{
+    static const char* const keys[CH_COUNT] = {"v", "i", "tc", "l", "m"};
+    const CaptureRecord* r = &cap_out[first];
+    char buffer[FMT_I32_MAX];
+
+    frame_mac_begin();
+    uart_send_string("{\"frame\":\"capture\"");
+    uart_send_device_id();
+    uart_send_field("seq", ++cap_seq);
+    uart_send_field("id", cap_id);
+    uart_send_field("first", first);
+
+    uart_send_string(",\"dt\":[");
+    for (uint16_t k = 0; k < n; k++) {
+        if (k) uart_send_char(',');
+        fmt_u32(buffer, r[k].t - cap_out[0].t);
+        uart_send_string(buffer);
+    }
+    uart_send_char(']');
+
+    for (uint8_t ch = 0; ch < CH_COUNT; ch++) {
+        uart_send_string(",\"");
+        uart_send_string(keys[ch]);
+        uart_send_string("\":[");
+        for (uint16_t k = 0; k < n; k++) {
+            if (k) uart_send_char(',');
+            fmt_u32(buffer, r[k].v[ch]);
+            uart_send_string(buffer);
+        }
+        uart_send_char(']');
+    }
+
+    // One array of FFT_N samples per record
+    uart_send_string(",\"w\":[");
+    for (uint16_t k = 0; k < n; k++) {
+        uart_send_string(k ? ",[" : "[");
+        for (uint16_t i = 0; i < FFT_N; i++) {
+            if (i) uart_send_char(',');
+            fmt_i32(buffer, r[k].w[i]);
+            uart_send_string(buffer);
+        }
+        uart_send_char(']');
+    }
+    uart_send_char(']');
+    frame_mac_end();
+}
+
+// Low-priority streaming: one chunk per call, only if it finishes
+// before the next sample is due so telemetry timing is untouched
+static void capture_stream_step(uint32_t next_sample_due)
+{
+    if (cap_state != CAP_STREAMING || !systime_reached(cap_next_chunk)) return;
+
+    uint32_t now = systime_now();
+    if ((int32_t)(next_sample_due - now) < (int32_t)MS_TO_TICKS(CAPTURE_CHUNK_TX_MS)) return;
+
+    // Captures are evidence: every frame is signed like a reading
+    if (cap_sent == 0) {
+        frame_mac_begin();
+        uart_send_string("{\"frame\":\"capture_start\"");
+        uart_send_device_id();
+        uart_send_field("seq", ++cap_seq);
+        uart_send_field("id", cap_id);
+        uart_send_field("records", cap_len);
+        uart_send_field("trigger", cap_trigger);
+        uart_send_field("wave_n", FFT_N);
+        frame_mac_end();
+    }
+
+    uint16_t n = cap_len - cap_sent;
+    if (n > CAPTURE_CHUNK) n = CAPTURE_CHUNK;
+    capture_send_chunk(cap_sent, n);
+    cap_sent += n;
+    cap_next_chunk = now + MS_TO_TICKS(CAPTURE_CHUNK_MS);
+
+    if (cap_sent == cap_len) {
+        frame_mac_begin();
+        uart_send_string("{\"frame\":\"capture_end\"");
+        uart_send_device_id();
+        uart_send_field("seq", ++cap_seq);
+        uart_send_field("id", cap_id);
+        frame_mac_end();
+        cap_state = CAP_IDLE;
+    }
+}
+
+/* ============== UART COMMAND CHANNEL ============== */
+// Frame: 0xA5 | cmd | len | payload[len] | xor(cmd, len, payload)
+// Bytes that arrive while in STOP/STANDBY only wake the core, so the
+// host leads each frame with a few 0xA5 preamble bytes
+#define CMD_SOF              (0xA5)
+#define CMD_MAX_PAYLOAD      (8)
+#define CMD_RX_BUF_SIZE      (64)   // power of two
+#define CMD_RX_HOLD_MS       (2000) // keep UART clocked after RX activity
+
+#define CMD_SET_PERIOD       (0x01)  // ch(1) period_ms(2 LE); ch 0xFF = all
+#define CMD_BURST            (0x02)  // seconds(2 LE)
+#define CMD_DISPLAY          (0x03)  // 0 = resume, 1 = pause
+#define CMD_QUERY            (0x04)  // reply with counter frames
+#define CMD_CAPTURE_CFG      (0x05)  // pre(2 LE) post(2 LE) line cycles
+
+static volatile uint8_t cmd_rx_buf[CMD_RX_BUF_SIZE];
+static volatile uint8_t cmd_rx_head = 0;
+static volatile uint8_t cmd_rx_tail = 0;
+static volatile uint32_t cmd_rx_hold_until = 0;
+
+typedef enum {
+    CMD_WAIT_SOF = 0,
+    CMD_WAIT_ID,
+    CMD_WAIT_LEN,
+    CMD_WAIT_PAYLOAD,
+    CMD_WAIT_CHECK
+} CmdParseState;
+
+static CmdParseState cmd_state = CMD_WAIT_SOF;
+static uint8_t cmd_id;
+static uint8_t cmd_len;
+static uint8_t cmd_pos;
+static uint8_t cmd_sum;
+static uint8_t cmd_payload[CMD_MAX_PAYLOAD];
+
+void UART_0_INST_IRQHandler(void)
+{
+    switch (DL_UART_Main_getPendingInterrupt(UART_0_INST)) {
+        case DL_UART_MAIN_IIDX_RX:
+            while (!DL_UART_Main_isRXFIFOEmpty(UART_0_INST)) {
+                uint8_t b = DL_UART_Main_receiveData(UART_0_INST);
+                uint8_t next = (cmd_rx_head + 1) & (CMD_RX_BUF_SIZE - 1);
+                if (next == cmd_rx_tail) {
+                    link_stats.rx_overflow++;
+                } else {
+                    cmd_rx_buf[cmd_rx_head] = b;
+                    cmd_rx_head = next;
+                }
+            }
+            pm_hold |= PM_HOLD_UART_RX;
+            cmd_rx_hold_until = systime_now() + MS_TO_TICKS(CMD_RX_HOLD_MS);
+            pm_event_pending = true;
+            break;
+        default:
+            break;
+    }
+}
+
+static void send_ack(uint8_t cmd, bool ok)
+{
+    uart_send_string("{\"frame\":\"ack\"");
+    uart_send_field("cmd", cmd);
+    uart_send_field("ok", ok ? 1 : 0);
+    uart_send_string("}\r\n");
+}
+
+void send_link_stats(void)
+{
+    uart_send_string("{\"frame\":\"counters\"");
+    uart_send_field("frames", link_stats.frames_sent);
+    uart_send_field("escalations", link_stats.escalations);
+    uart_send_field("cmd_ok", link_stats.cmd_ok);
+    uart_send_field("cmd_err", link_stats.cmd_errors);
+    uart_send_field("rx_overflow", link_stats.rx_overflow);
+    uart_send_field("captures", link_stats.captures);
+    uart_send_field("cap_dropped", link_stats.captures_dropped);
+    uart_send_field("burst", burst_active ? 1 : 0);
+    uart_send_field("period_v", channels[CH_VOLTAGE].period_ms);
+    uart_send_field("period_i", channels[CH_CURRENT].period_ms);
+    uart_send_field("period_t", channels[CH_TEMP].period_ms);
+    uart_send_field("period_l", channels[CH_LIGHT].period_ms);
+    uart_send_field("period_m", channels[CH_MAG].period_ms);
+    uart_send_field("fft_runs", harm_stats.runs);
+    uart_send_field("fft_cycles", harm_stats.cycles_last);
+    uart_send_field("fft_cycles_max", harm_stats.cycles_max);
+    uart_send_field("fft_over", harm_stats.over_budget);
+    uart_send_string("}\r\n");
+}
+
+static bool cmd_execute(uint8_t cmd, const uint8_t* p, uint8_t len)
+{
+    uint32_t now = systime_now();
+
+    switch (cmd) {
+        case CMD_SET_PERIOD: {
+            if (len != 3) return false;
+            uint16_t period = p[1] | ((uint16_t)p[2] << 8);
+            if (period < PERIOD_MIN_MS || period > PERIOD_MAX_MS) return false;
+            if (p[0] != 0xFF && p[0] >= CH_COUNT) return false;
+
+            for (uint8_t ch = 0; ch < CH_COUNT; ch++) {
+                if (p[0] == 0xFF || p[0] == ch) {
+                    channels[ch].period_ms = period;
+                    channels[ch].next_due = now;
+                }
+            }
+            return true;
+        }
+        case CMD_BURST: {
+            if (len != 2) return false;
+            uint16_t seconds = p[0] | ((uint16_t)p[1] << 8);
+            burst_active = seconds > 0;
+            burst_until = now + (uint32_t)seconds * LFCLK_HZ;
+            for (uint8_t ch = 0; ch < CH_COUNT; ch++) {
+                channels[ch].next_due = now;
+            }
+            return true;
+        }
+        case CMD_DISPLAY:
+            if (len != 1 || p[0] > 1) return false;
+            display_paused = p[0];
+            return true;
+        case CMD_QUERY:
+            if (len != 0) return false;
+            send_link_stats();
+            send_power_stats();
+            send_trend_stats();
+            send_tamper_stats();
+            return true;
+        case CMD_CAPTURE_CFG:
+            if (len != 4) return false;
+            return capture_configure(p[0] | ((uint16_t)p[1] << 8), p[2] | ((uint16_t)p[3] << 8));
+        default:
+            return false;
+    }
+}
+
+// Drains the RX ring and runs any complete frames
+static void cmd_poll(void)
+{
+    while (cmd_rx_tail != cmd_rx_head) {
+        uint8_t b = cmd_rx_buf[cmd_rx_tail];
+        cmd_rx_tail = (cmd_rx_tail + 1) & (CMD_RX_BUF_SIZE - 1);
+
+        switch (cmd_state) {
+            case CMD_WAIT_SOF:
+                if (b == CMD_SOF) cmd_state = CMD_WAIT_ID;
+                break;
+            case CMD_WAIT_ID:
+                if (b == CMD_SOF) break;  // preamble
+                cmd_id = b;
+                cmd_sum = b;
+                cmd_state = CMD_WAIT_LEN;
+                break;
+            case CMD_WAIT_LEN:
+                if (b > CMD_MAX_PAYLOAD) {
+                    link_stats.cmd_errors++;
+                    cmd_state = CMD_WAIT_SOF;
+                    break;
+                }
+                cmd_len = b;
+                cmd_pos = 0;
+                cmd_sum ^= b;
+                cmd_state = cmd_len ? CMD_WAIT_PAYLOAD : CMD_WAIT_CHECK;
+                break;
+            case CMD_WAIT_PAYLOAD:
+                cmd_payload[cmd_pos++] = b;
+                cmd_sum ^= b;
+                if (cmd_pos == cmd_len) cmd_state = CMD_WAIT_CHECK;
+                break;
+            case CMD_WAIT_CHECK: {
+                bool ok = (b == cmd_sum) && cmd_execute(cmd_id, cmd_payload, cmd_len);
+                if (ok) link_stats.cmd_ok++;
+                else link_stats.cmd_errors++;
+                send_ack(cmd_id, ok);
+                cmd_state = CMD_WAIT_SOF;
+                break;
+            }
+            default:
+                cmd_state = CMD_WAIT_SOF;
+                break;
+        }
+    }
+
+    if ((pm_hold & PM_HOLD_UART_RX) && systime_reached(cmd_rx_hold_until)) {
+        __disable_irq();
+        pm_hold &= ~PM_HOLD_UART_RX;
+        __enable_irq();
+    }
+}
+
+/* ============== FORMATTER BENCHMARK ============== */
+#if FMT_BENCH
+// The divide-per-digit routine fmt_u32() replaced, kept as the baseline
+static void int_to_string_div(uint32_t num, char* str)
+{
+    int i = 0;
+    if (num == 0) {
+        str[0] = '0';
+        str[1] = '\0';
+        return;
+    }
+
+    while (num > 0) {
+        str[i++] = (num % 10) + '0';
+        num /= 10;
+    }
+    str[i] = '\0';
+
+    int start = 0, end = i - 1;
+    while (start < end) {
+        char temp = str[start];
+        str[start] = str[end];
+        str[end] = temp;
+        start++;
+        end--;
+    }
+}
+
+// Telemetry-sized values plus 32-bit extremes; volatile so the baseline
+// cannot be constant-folded
+static const volatile uint32_t fmt_bench_values[] = {0, 7, 42, 237, 4095, 65535, 1000000, 4294967295U};
+#define FMT_BENCH_VALUES (sizeof(fmt_bench_values) / sizeof(fmt_bench_values[0]))
+
+// Cycles for the whole value set with each routine, and for one DD/MM/YYYY
+// date the old way and the new way. Interrupts are off while measuring.
+static volatile DateTime fmt_bench_dt = {10, 1, 2026, 1, 5, 0};
+
+static void send_fmt_bench(void)
+{
+    char buffer[FMT_I32_MAX];
+    DateTime dt = fmt_bench_dt;
+    uint32_t start, cyc_old, cyc_new, cyc_date_old, cyc_date_new, cyc_fixed;
+
+    __disable_irq();
+
+    start = cycle_now();
+    for (uint8_t i = 0; i < FMT_BENCH_VALUES; i++) int_to_string_div(fmt_bench_values[i], buffer);
+    cyc_old = cycles_since(start);
+
+    start = cycle_now();
+    for (uint8_t i = 0; i < FMT_BENCH_VALUES; i++) fmt_u32(buffer, fmt_bench_values[i]);
+    cyc_new = cycles_since(start);
+
+    start = cycle_now();
+    buffer[0] = (dt.day / 10) + '0';
+    buffer[1] = (dt.day % 10) + '0';
+    buffer[3] = (dt.month / 10) + '0';
+    buffer[4] = (dt.month % 10) + '0';
+    buffer[6] = ((dt.year / 1000) % 10) + '0';
+    buffer[7] = ((dt.year / 100) % 10) + '0';
+    buffer[8] = ((dt.year / 10) % 10) + '0';
+    buffer[9] = (dt.year % 10) + '0';
+    cyc_date_old = cycles_since(start);
+
+    start = cycle_now();
+    fmt_u32_width(&buffer[0], dt.day, 2, '0');
+    fmt_u32_width(&buffer[3], dt.month, 2, '0');
+    fmt_u32_width(&buffer[6], dt.year, 4, '0');
+    cyc_date_new = cycles_since(start);
+
+    start = cycle_now();
+    fmt_fixed(buffer, -123456, 2, 10);
+    cyc_fixed = cycles_since(start);
+
+    __enable_irq();
+
+    uart_send_string("{\"frame\":\"fmt_bench\"");
+    uart_send_field("n", FMT_BENCH_VALUES);
+    uart_send_field("div", cyc_old);
+    uart_send_field("recip", cyc_new);
+    uart_send_field("date_div", cyc_date_old);
+    uart_send_field("date_recip", cyc_date_new);
+    uart_send_field("fixed", cyc_fixed);
+    uart_send_string("}\r\n");
+}
+#endif
+
 /* ============== MAIN ============== */
 int main(void)
 {
     SYSCFG_DL_init();
 
+    NVIC_EnableIRQ(TIMER_0_INST_INT_IRQN);
+    NVIC_EnableIRQ(UART_0_INST_INT_IRQN);
+    DL_TimerG_startCounter(TIMER_0_INST);
+    cycle_counter_init();
+    device_id_init();
+    boot_id_init();
+    frame_auth_init();
+    tamper_init();
+
     DC_LOW();
     RST_HIGH();
-    ili9341_init();
 
     uint16_t hist_voltage = 237;
     uint16_t hist_current = 95;
@@ -433,49 +1987,133 @@ int main(void)
     DateTime last_tamper_dt = {10, 1, 2026, 1, 5, 0};
     
     uint16_t loop_counter = 0;
+    bool is_tamper = false;
+    bool tamper_edge = false;
+    bool irq_tamper = false;    // input interrupt not yet carried by a sensor frame
+    bool redraw = false;
 
     uart_send_string("Smart Meter System initialized\r\n");
-    display_meter_screen(0, hist_voltage, hist_current, hist_temp, hist_light, hist_mag, hist_events, &last_tamper_dt);
+#if FMT_BENCH
+    send_fmt_bench();
+#endif
+
+    // First sample is taken immediately; the panel comes up alongside
+    uint32_t next_slot = systime_now();
 
     while(1)
     {
-        loop_counter++;
-        bool is_tamper = (loop_counter % 4 == 0);
+        tamper_service();
+        if (tamper_asserts) {
+            // A tamper input fired: flag this period as it would a detected one
+            hist_events += tamper_asserts;
+            tamper_asserts = 0;
+            irq_tamper = true;
+            is_tamper = true;
+            tamper_edge = true;
+            redraw = true;
+        }
+
+        bool lcd_ready = ili9341_init_step();
+        if (lcd_ready && boot_stats.lcd_ready == 0) {
+            boot_stats.lcd_ready = systime_now();
+        }
+
+        bool drawing = lcd_ready && display_step();
+        if (lcd_ready && !drawing && !boot_stats.reported) {
+            boot_stats.first_screen = systime_now();
+            boot_stats.reported = true;
+            send_boot_stats();
+        }
+        if (boot_stats.reported && !drawing) {
+            drawing = trend_init_step();
+        }
+
+        tamper_service();
+        cmd_poll();
+        capture_stream_step(systime_earliest(next_slot, next_channel_due()));
+        tamper_service();
+
+        // Low-power wait instead of spinning in delay_ms()
+        if (!drawing) {
+            uint32_t wake = systime_earliest(next_slot, next_channel_due());
+            if (capture_streaming()) {
+                wake = systime_earliest(wake, cap_next_chunk);
+            }
+            if (!lcd_ready) {
+                wake = systime_earliest(wake, lcd_deadline);
+            }
+            if (pm_hold & PM_HOLD_UART_RX) {
+                wake = systime_earliest(wake, cmd_rx_hold_until);
+            }
+            power_idle_until(tamper_next_rearm(wake));
+            pm_event_pending = false;
+        }
+
+        // Simulated incidents: every 4th base period is a tamper
+        if (systime_reached(next_slot)) {
+            next_slot += MS_TO_TICKS(DELAY);
+            loop_counter++;
+            bool simulated = (loop_counter % 4 == 0);
+            if (simulated) {
+                hist_events++;
+                datetime_add_minutes(&last_tamper_dt, 5);
+            }
+            // A latched input interrupt still flags the new period
+            is_tamper = simulated || irq_tamper;
+            tamper_edge = is_tamper;
+            redraw = true;
+
+            if (loop_counter % POWER_REPORT_EVERY == 0) {
+                send_power_stats();
+                send_trend_stats();
+                send_tamper_stats();
+            }
+        }
+
+        uint32_t current_due = channels[CH_CURRENT].next_due;
+        if (!sample_due_channels(is_tamper)) continue;
+
+        uint16_t voltage = channels[CH_VOLTAGE].value;
+        uint16_t current = channels[CH_CURRENT].value;
+        uint16_t temp = channels[CH_TEMP].value;
+        uint16_t light = channels[CH_LIGHT].value;
+        uint16_t mag = channels[CH_MAG].value;
 
-        uint16_t voltage, current, temp, light, mag;
-        
-        voltage = random_range(230, 240);
-        
         if (is_tamper) {
-            current = random_range(50, 150);
-            temp = random_range(40, 60);
-            light = random_range(150, 250);
-            mag = random_range(80, 150);
-            
             hist_voltage = voltage;
             hist_current = current;
             hist_temp = temp;
             hist_light = light;
             hist_mag = mag;
-            hist_events++;
-            
-            datetime_add_minutes(&last_tamper_dt, 5);
-            
-        } else {
-            current = random_range(1, 15);
-            temp = random_range(20, 35);
-            light = random_range(0, 30);
-            mag = random_range(0, 10);
         }
-        
-        send_sensor_data(is_tamper, voltage, current, temp, light, mag);
-        
-        if (is_tamper) {
-            display_meter_screen(is_tamper, voltage, current, temp, light, mag, hist_events, &last_tamper_dt);
-        } else {
-            display_meter_screen(is_tamper, hist_voltage, hist_current, hist_temp, hist_light, hist_mag, hist_events, &last_tamper_dt);
+
+        uint16_t capture_id = 0;
+        if (tamper_edge) {
+            capture_id = capture_trigger();
+            tamper_edge = false;
+        }
+        uint32_t sampled_at = systime_now();
+
+        // Spectrum and waveform capture only when the current channel itself was sampled
+        const HarmonicFeatures* harm = NULL;
+        if (channels[CH_CURRENT].next_due != current_due) {
+            harm = harmonic_update(current, is_tamper, mag);
+            capture_record(sampled_at, harm_window);
         }
 
-        delay_ms(DELAY);  // 3 second delay
+        tamper_service();
+        send_sensor_data(is_tamper, voltage, current, temp, light, mag, capture_id, harm,
+                         link_stats.frames_sent + 1, sampled_at);
+        irq_tamper = false;
+        if (++link_stats.frames_sent == 1) {
+            boot_stats.first_sample = systime_now();
+        }
+        trend_push(voltage, current, is_tamper);
+
+        // The screen only changes once per base period, not per sample
+        if (redraw) {
+            display_meter_screen(is_tamper, hist_voltage, hist_current, hist_temp, hist_light, hist_mag, hist_events, &last_tamper_dt);
+            redraw = false;
+        }
     }
 }
@@ -0,0 +1,157 @@
+#include "fft_q15.h"
+
+#if defined(__MSPM0G3507__)
+#include "ti_msp_dl_config.h"
+#endif
+
+/* ================== TWIDDLE TABLE ================== */
+// sin(2*pi*k/FFT_N) in Q15; cos(x) = sin_q15[(k + FFT_N/4) & (FFT_N-1)]
+static const int16_t sin_q15[FFT_N] = {
+         0,   3212,   6393,   9512,  12539,  15446,  18204,  20787,
+     23170,  25329,  27245,  28898,  30273,  31356,  32137,  32609,
+     32767,  32609,  32137,  31356,  30273,  28898,  27245,  25329,
+     23170,  20787,  18204,  15446,  12539,   9512,   6393,   3212,
+         0,  -3212,  -6393,  -9512, -12539, -15446, -18204, -20787,
+    -23170, -25329, -27245, -28898, -30273, -31356, -32137, -32609,
+    -32767, -32609, -32137, -31356, -30273, -28898, -27245, -25329,
+    -23170, -20787, -18204, -15446, -12539,  -9512,  -6393,  -3212
+};
+
+int16_t sin_q15_lookup(uint16_t k)
+{
+    return sin_q15[k & (FFT_N - 1)];
+}
+
+/* ================== DIVIDE ================== */
+// The M0+ has no divide instruction; route the few divides through MATHACL
+#if defined(__MSPM0G3507__)
+static const DL_MathACL_operationConfig fft_div_config = {
+    .opType      = DL_MATHACL_OP_TYPE_DIV,
+    .opSign      = DL_MATHACL_OPSIGN_UNSIGNED,
+    .iterations  = 0,
+    .scaleFactor = 0,
+    .qType       = DL_MATHACL_Q_TYPE_Q0
+};
+#endif
+
+static uint32_t fft_div(uint32_t num, uint32_t den)
+{
+#if defined(__MSPM0G3507__)
+    DL_MathACL_startDivOperation(MATHACL, &fft_div_config, num, den);
+    DL_MathACL_waitForOperation(MATHACL);
+    return DL_MathACL_getResultOne(MATHACL);
+#else
+    return num / den;
+#endif
+}
+
+/* ================== SQUARE ROOT ================== */
+// Bit-by-bit integer square root: shifts and adds only
+uint32_t isqrt32(uint32_t x)
+{
+    uint32_t res = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > x) bit >>= 2;
+    while (bit) {
+        if (x >= res + bit) {
+            x -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return res;
+}
+
+/* ================== FFT ================== */
+void fft_q15(int16_t* re, int16_t* im)
+{
+    // Bit-reversal permutation
+    uint16_t j = 0;
+    for (uint16_t i = 1; i < FFT_N; i++) {
+        uint16_t bit = FFT_N >> 1;
+        while (j & bit) {
+            j ^= bit;
+            bit >>= 1;
+        }
+        j |= bit;
+        if (i < j) {
+            int16_t t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    // Butterflies, halving every stage so |X| stays within Q15
+    for (uint16_t len = 2, step = FFT_N / 2; len <= FFT_N; len <<= 1, step >>= 1) {
+        uint16_t half = len >> 1;
+        for (uint16_t i = 0; i < FFT_N; i += len) {
+            for (uint16_t k = 0; k < half; k++) {
+                uint16_t w = k * step;
+                int32_t wr = sin_q15[(w + FFT_N / 4) & (FFT_N - 1)];
+                int32_t wi = -sin_q15[w];
+                uint16_t a = i + k;
+                uint16_t b = a + half;
+
+                int32_t tr = (wr * re[b] - wi * im[b] + 0x4000) >> 15;
+                int32_t ti = (wr * im[b] + wi * re[b] + 0x4000) >> 15;
+
+                re[b] = (int16_t)((re[a] - tr) >> 1);
+                im[b] = (int16_t)((im[a] - ti) >> 1);
+                re[a] = (int16_t)((re[a] + tr) >> 1);
+                im[a] = (int16_t)((im[a] + ti) >> 1);
+            }
+        }
+    }
+}
+
+/* ================== HARMONIC FEATURES ================== */
+#define THD_RATIO_MAX   10000   // clamp each harmonic at 10x fundamental
+
+void harmonic_analyze(const int16_t* samples, HarmonicFeatures* out)
+{
+    int16_t re[FFT_N];
+    int16_t im[FFT_N];
+
+    // Block floating point: left-align small signals so the per-stage
+    // scaling does not push them into the rounding noise
+    uint16_t peak = 0;
+    for (uint16_t i = 0; i < FFT_N; i++) {
+        int16_t s = samples[i];
+        uint16_t a = s < 0 ? (uint16_t)(-(int32_t)s) : (uint16_t)s;
+        if (a > peak) peak = a;
+    }
+    uint16_t shift = 0;
+    while (peak != 0 && (peak << (shift + 1)) < 0x4000) shift++;
+
+    for (uint16_t i = 0; i < FFT_N; i++) {
+        re[i] = (int16_t)(samples[i] * (1 << shift));
+        im[i] = 0;
+    }
+    fft_q15(re, im);
+
+    // Real input: peak amplitude of bin h is 2*|X[h]| after the 1/N scaling.
+    // mag[] stays at the aligned scale; ratios below do not depend on it.
+    uint32_t mag[FFT_HARMONICS];
+    for (uint16_t h = 0; h < FFT_HARMONICS; h++) {
+        int32_t r = re[h + 1];
+        int32_t q = im[h + 1];
+        mag[h] = isqrt32((uint32_t)(r * r) + (uint32_t)(q * q)) << 1;
+        uint32_t m = (mag[h] + ((1UL << shift) >> 1)) >> shift;
+        out->magnitude[h] = m > 0xFFFF ? 0xFFFF : (uint16_t)m;
+    }
+
+    // THD from per-harmonic ratios so the sum of squares fits in 32 bits
+    out->thd_permille = 0;
+    if (mag[0] == 0) return;
+
+    uint32_t sum_sq = 0;
+    for (uint16_t h = 1; h < FFT_HARMONICS; h++) {
+        uint32_t ratio = fft_div(mag[h] * 1000UL, mag[0]);
+        if (ratio > THD_RATIO_MAX) ratio = THD_RATIO_MAX;
+        sum_sq += ratio * ratio;
+    }
+    uint32_t thd = isqrt32(sum_sq);
+    out->thd_permille = thd > 0xFFFF ? 0xFFFF : (uint16_t)thd;
+}
@@ -0,0 +1,28 @@
+#ifndef FFT_Q15_H
+#define FFT_Q15_H
+
+#include <stdint.h>
+
+/* ================== FIXED-POINT FFT (Q15) ================== */
+// One line cycle is sampled FFT_N times, so bin h is exactly the h-th harmonic
+#define FFT_N           64
+#define FFT_LOG2N       6
+#define FFT_HARMONICS   8      // fundamental + 2nd..8th
+
+typedef struct {
+    uint16_t magnitude[FFT_HARMONICS];  // peak amplitude of harmonic h+1, input units
+    uint16_t thd_permille;              // sqrt(sum h2..h8 ^2) / h1, per mille
+} HarmonicFeatures;
+
+// In-place radix-2 FFT, scaled by 1/FFT_N (one >>1 per stage, cannot overflow)
+void fft_q15(int16_t* re, int16_t* im);
+
+// FFT one cycle-aligned window and extract harmonic magnitudes and THD
+void harmonic_analyze(const int16_t* samples, HarmonicFeatures* out);
+
+uint32_t isqrt32(uint32_t x);
+
+// sin(2*pi*k/FFT_N) in Q15, k taken modulo FFT_N
+int16_t sin_q15_lookup(uint16_t k);
+
+#endif
@@ -0,0 +1,86 @@
+#include "fmt.h"
+
+static const uint32_t pow10_u32[10] = {
+    1U, 10U, 100U, 1000U, 10000U,
+    100000U, 1000000U, 10000000U, 100000000U, 1000000000U
+};
+
+// Exact x/10 for every uint32_t; the 16-bit multiply covers the common case
+static inline uint32_t div10(uint32_t x)
+{
+    if (x < 81920U) return (x * 0xCCCDU) >> 19;
+    return (uint32_t)(((uint64_t)x * 0xCCCCCCCDULL) >> 35);
+}
+
+static uint8_t count_digits(uint32_t v)
+{
+    uint8_t n = 1;
+    while (n < 10 && v >= pow10_u32[n]) n++;
+    return n;
+}
+
+// Digits of v written backwards from end, at least min_digits of them,
+// with '.' in front of the last frac digits
+static void put_digits(char* end, uint32_t v, uint8_t min_digits, uint8_t frac)
+{
+    uint8_t n = 0;
+    do {
+        uint32_t q = div10(v);
+        *--end = (char)('0' + (v - q * 10U));
+        v = q;
+        if (++n == frac) *--end = '.';
+    } while (v != 0 || n < min_digits);
+}
+
+// Shared layout: [spaces][-][zeros]digits[.digits]
+static uint8_t fmt_layout(char* buf, bool neg, uint32_t mag, uint8_t min_digits,
+                          uint8_t frac, uint8_t width)
+{
+    uint8_t digits = count_digits(mag);
+    if (digits < min_digits) digits = min_digits;
+
+    uint8_t body = digits + (frac ? 1 : 0) + (neg ? 1 : 0);
+    uint8_t len = body < width ? width : body;
+    char* p = buf;
+
+    for (uint8_t i = body; i < len; i++) *p++ = ' ';
+    if (neg) *p++ = '-';
+    put_digits(buf + len, mag, min_digits, frac);
+    buf[len] = '\0';
+    return len;
+}
+
+uint8_t fmt_u32(char* buf, uint32_t v)
+{
+    return fmt_layout(buf, false, v, 1, 0, 0);
+}
+
+uint8_t fmt_i32(char* buf, int32_t v)
+{
+    uint32_t mag = v < 0 ? 0U - (uint32_t)v : (uint32_t)v;
+    return fmt_layout(buf, v < 0, mag, 1, 0, 0);
+}
+
+uint8_t fmt_u32_width(char* buf, uint32_t v, uint8_t width, char pad)
+{
+    if (pad == '0') return fmt_layout(buf, false, v, width ? width : 1, 0, 0);
+    return fmt_layout(buf, false, v, 1, 0, width);
+}
+
+uint8_t fmt_fixed(char* buf, int32_t v, uint8_t frac, uint8_t width)
+{
+    uint32_t mag = v < 0 ? 0U - (uint32_t)v : (uint32_t)v;
+    return fmt_layout(buf, v < 0, mag, frac + 1, frac, width);
+}
+
+uint8_t fmt_q(char* buf, int32_t v, uint8_t q_bits, uint8_t frac, uint8_t width)
+{
+    uint32_t mag = v < 0 ? 0U - (uint32_t)v : (uint32_t)v;
+
+    // mag * 10^frac / 2^q_bits, rounded half away from zero
+    uint64_t scaled = (uint64_t)mag * pow10_u32[frac];
+    if (q_bits) scaled = (scaled + (1ULL << (q_bits - 1))) >> q_bits;
+
+    bool neg = v < 0 && scaled != 0;
+    return fmt_layout(buf, neg, (uint32_t)scaled, frac + 1, frac, width);
+}
@@ -0,0 +1,34 @@
+#ifndef FMT_H
+#define FMT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* ================== DIVIDE-FREE NUMBER FORMATTING ================== */
+// Digits come from reciprocal multiplication (x/10 == x*0xCCCD >> 19 for
+// x < 81920), never from the M0+'s software divide. Every function writes
+// straight into the caller's buffer, NUL-terminates it and returns the
+// length excluding the NUL.
+//
+// Buffer sizes: FMT_U32_MAX for unsigned, FMT_I32_MAX for signed and
+// fixed-point, or width + 1 when width is larger.
+#define FMT_U32_MAX  11     // "4294967295"
+#define FMT_I32_MAX  13     // "-4294967.295" and friends
+
+// Plain decimal: 1234 -> "1234"
+uint8_t fmt_u32(char* buf, uint32_t v);
+uint8_t fmt_i32(char* buf, int32_t v);
+
+// Right-aligned in width characters, padded with pad (' ' or '0').
+// Wider numbers are written in full, never truncated.
+uint8_t fmt_u32_width(char* buf, uint32_t v, uint8_t width, char pad);
+
+// Decimal fixed point, v counts units of 10^-frac (frac <= 9):
+// (-1234, 2) -> "-12.34". Right-aligned with spaces in width (0 = none).
+uint8_t fmt_fixed(char* buf, int32_t v, uint8_t frac, uint8_t width);
+
+// Binary fixed point Q(q_bits), rounded to frac decimals (frac <= 4,
+// q_bits <= 31, rounded value must fit 32 bits): (0x8000, 15, 3) -> "1.000"
+uint8_t fmt_q(char* buf, int32_t v, uint8_t q_bits, uint8_t frac, uint8_t width);
+
+#endif
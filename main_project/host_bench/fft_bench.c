@@ -0,0 +1,189 @@
+/*
+ * Host-side accuracy and speed check for fft_q15.c
+ *
+ * Build and run from main_project/:
+ *   gcc -O2 -I. -o fft_bench host_bench/fft_bench.c fft_q15.c -lm && ./fft_bench
+ *
+ * Compares harmonic_analyze() against a double-precision DFT on synthetic
+ * line-cycle waveforms, then prints a worst-case Cortex-M0+ cycle model of
+ * one window against the firmware's HARM_BUDGET_CYCLES. Exits non-zero if
+ * any error exceeds the tolerances or the model exceeds the budget.
+ * Measured target cycles come from the firmware itself ("fft_cycles_max"
+ * in the counters frame); the host timing here is only for regressions.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "fft_q15.h"
+
+#define MAG_TOL_PCT_FS  0.5     // magnitude error, % of full scale
+#define THD_TOL_PM      5.0     // THD error, per mille
+#define BENCH_ITER      200000
+
+// Mirrors empty.c: one 50 Hz line cycle at CPUCLK_FREQ
+#define CPUCLK_FREQ         32000000UL
+#define HARM_BUDGET_CYCLES  (CPUCLK_FREQ / 50)
+
+typedef struct {
+    const char* name;
+    double amp[FFT_HARMONICS];      // peak amplitude per harmonic, counts
+    double phase[FFT_HARMONICS];
+    double noise;                   // uniform noise, +/- counts
+} Case;
+
+static const Case cases[] = {
+    { "pure 50%FS",        { 16000 },                              { 0 },               0 },
+    { "pure full-scale",   { 32000 },                              { 0 },               0 },
+    { "pure small",        { 400 },                                { 0 },               0 },
+    { "resistive + noise", { 20000, 0, 400, 0, 200 },              { 0, 0, 1.0, 0, 2 }, 50 },
+    { "rectifier bypass",  { 12000, 0, 3600, 0, 2400, 0, 1200 },   { 0, 0, 0.5, 0, 1, 0, 2 }, 0 },
+    { "CT saturation",     { 9000, 2700, 900 },                    { 0, 1.2, 0.3 },     0 },
+    { "all harmonics",     { 8000, 1000, 1000, 1000, 1000, 1000, 1000, 1000 }, { 0, 1, 2, 3, 4, 5, 6, 0.5 }, 0 },
+};
+
+static void synth(const Case* c, int16_t* out)
+{
+    for (int n = 0; n < FFT_N; n++) {
+        double x = 0;
+        for (int h = 0; h < FFT_HARMONICS; h++)
+            x += c->amp[h] * cos(2 * M_PI * (h + 1) * n / FFT_N + c->phase[h]);
+        if (c->noise > 0)
+            x += c->noise * (2.0 * rand() / RAND_MAX - 1.0);
+        if (x > 32767) x = 32767;
+        if (x < -32768) x = -32768;
+        out[n] = (int16_t)lrint(x);
+    }
+}
+
+static void reference(const int16_t* x, double* mag, double* thd_pm)
+{
+    for (int h = 0; h < FFT_HARMONICS; h++) {
+        double re = 0, im = 0;
+        for (int n = 0; n < FFT_N; n++) {
+            re += x[n] * cos(2 * M_PI * (h + 1) * n / FFT_N);
+            im -= x[n] * sin(2 * M_PI * (h + 1) * n / FFT_N);
+        }
+        mag[h] = 2.0 * sqrt(re * re + im * im) / FFT_N;
+    }
+    double sum = 0;
+    for (int h = 1; h < FFT_HARMONICS; h++) sum += mag[h] * mag[h];
+    *thd_pm = mag[0] > 0 ? 1000.0 * sqrt(sum) / mag[0] : 0;
+}
+
+/* ---- Cortex-M0+ cycle model ----
+ * Trip counts follow the loops of fft_q15.c at their worst case (isqrt32
+ * always 16 rounds, full block-floating shift). Per-iteration costs are
+ * hand-counted Thumb-1 sequences of each loop body on the MSPM0G3507:
+ * ALU and MULS 1 cycle (single-cycle multiplier), LDR/STR 2, taken branch
+ * 2 + 1 flash wait state at 32 MHz, and the twiddle loads from flash also
+ * pay the wait state. Each body carries a few spill loads/stores, since
+ * the butterfly keeps more values live than the 8 low registers hold.
+ */
+#define CYC_PEAK        12   // LDRSH, abs, compare/select, loop
+#define CYC_SHIFT       6    // LSL, compare, add, loop
+#define CYC_SCALE       14   // LDRSH, LSL, 2 x STRH, loop
+#define CYC_BITREV      10   // outer body: mask, OR, compare, loop
+#define CYC_BITREV_CARRY 6   // inner "while (j & bit)" round
+#define CYC_SWAP        22   // 4 x LDRH + 4 x STRH + addressing
+#define CYC_BUTTERFLY   80   // 2 twiddles (flash), 4 loads, 4 MULS, 4 stores, 6 spills
+#define CYC_GROUP       10   // middle loop: i += len, compare, branch
+#define CYC_STAGE       14   // outer loop: len/step/half update
+#define CYC_CALL        14   // BL + PUSH/POP + return
+#define CYC_ISQRT_ROUND 11   // compare, subtract/shift select, bit >>= 2, loop
+#define CYC_MAG         22   // 2 x LDRSH, 2 x MULS, rounding shift, saturate, STRH
+#define CYC_DIV         60   // MATHACL: 5 register writes, DIV latency, poll, read
+#define CYC_RATIO       12   // x1000, clamp, square, accumulate, loop
+
+typedef struct {
+    const char* name;
+    uint32_t count;
+    uint32_t cycles;
+} CostLine;
+
+static uint32_t model_cycles(void)
+{
+    // Bit reversal is data-independent: replay its control flow
+    uint32_t carries = 0, swaps = 0;
+    uint16_t j = 0;
+    for (uint16_t i = 1; i < FFT_N; i++) {
+        uint16_t bit = FFT_N >> 1;
+        while (j & bit) { j ^= bit; bit >>= 1; carries++; }
+        j |= bit;
+        if (i < j) swaps++;
+    }
+
+    uint32_t groups = 0;
+    for (uint16_t len = 2; len <= FFT_N; len <<= 1) groups += FFT_N / len;
+
+    const CostLine lines[] = {
+        { "peak scan",       FFT_N,                          CYC_PEAK },
+        { "block shift",     14,                             CYC_SHIFT },
+        { "scale/copy",      FFT_N,                          CYC_SCALE },
+        { "bitrev outer",    FFT_N - 1,                      CYC_BITREV },
+        { "bitrev carry",    carries,                        CYC_BITREV_CARRY },
+        { "bitrev swap",     swaps,                          CYC_SWAP },
+        { "butterfly",       FFT_LOG2N * FFT_N / 2,          CYC_BUTTERFLY },
+        { "butterfly group", groups,                         CYC_GROUP },
+        { "stage",           FFT_LOG2N,                      CYC_STAGE },
+        { "magnitude",       FFT_HARMONICS,                  CYC_MAG },
+        { "isqrt call",      FFT_HARMONICS + 1,              CYC_CALL },
+        { "isqrt round",     (FFT_HARMONICS + 1) * 16,       CYC_ISQRT_ROUND },
+        { "thd ratio",       FFT_HARMONICS - 1,              CYC_RATIO },
+        { "mathacl divide",  FFT_HARMONICS - 1,              CYC_DIV },
+        { "call overhead",   2,                              CYC_CALL },
+    };
+
+    uint32_t total = 0;
+    printf("\nCortex-M0+ cycle model, worst case per window:\n");
+    for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++) {
+        uint32_t c = lines[i].count * lines[i].cycles;
+        total += c;
+        printf("  %-16s %5u x %3u = %6u\n", lines[i].name, lines[i].count, lines[i].cycles, c);
+    }
+    printf("  %-16s %21u cycles, %.1f us, %.2f%% of HARM_BUDGET_CYCLES (%lu)\n",
+           "total", total, total * 1e6 / CPUCLK_FREQ,
+           total * 100.0 / HARM_BUDGET_CYCLES, HARM_BUDGET_CYCLES);
+    return total;
+}
+
+int main(void)
+{
+    int16_t x[FFT_N];
+    HarmonicFeatures f;
+    int failures = 0;
+
+    srand(1);
+    printf("%-20s %12s %10s %10s\n", "case", "max err %FS", "thd ref", "thd q15");
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        double mag[FFT_HARMONICS], thd;
+        synth(&cases[i], x);
+        reference(x, mag, &thd);
+        harmonic_analyze(x, &f);
+
+        double worst = 0;
+        for (int h = 0; h < FFT_HARMONICS; h++) {
+            double err = fabs(f.magnitude[h] - mag[h]) * 100.0 / 32768.0;
+            if (err > worst) worst = err;
+        }
+        // THD of tiny signals is dominated by quantisation; only check it above 1% FS
+        int thd_ok = mag[0] < 328 || fabs(f.thd_permille - thd) <= THD_TOL_PM;
+        int ok = worst <= MAG_TOL_PCT_FS && thd_ok;
+        failures += !ok;
+        printf("%-20s %12.3f %10.1f %10u %s\n",
+               cases[i].name, worst, thd, f.thd_permille, ok ? "" : "FAIL");
+    }
+
+    synth(&cases[4], x);
+    clock_t start = clock();
+    volatile uint16_t sink = 0;
+    for (int i = 0; i < BENCH_ITER; i++) {
+        harmonic_analyze(x, &f);
+        sink += f.thd_permille;
+    }
+    double ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / BENCH_ITER;
+    printf("\nharmonic_analyze: %.0f ns/window on host (%d iterations)\n", ns, BENCH_ITER);
+
+    if (model_cycles() > HARM_BUDGET_CYCLES) failures++;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * Host-side correctness and speed check for fmt.c
+ *
+ * Build and run from main_project/:
+ *   gcc -O2 -I. -o fmt_bench host_bench/fmt_bench.c fmt.c -lm && ./fmt_bench
+ *
+ * Checks every formatter against snprintf (exhaustively for the first
+ * 2^24 values, then edges and a pseudo-random sweep) and times fmt_u32()
+ * against the old divide-per-digit int_to_string(). On-target cycle
+ * counts come from the firmware's "fmt_bench" frame (FMT_BENCH in empty.c);
+ * host timings only catch regressions, since x86 divides in hardware.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "fmt.h"
+
+#define BENCH_ITER  20000000
+
+// The routine fmt_u32() replaces, kept verbatim for comparison
+static void int_to_string(uint32_t num, char* str)
+{
+    int i = 0;
+    if (num == 0) {
+        str[0] = '0';
+        str[1] = '\0';
+        return;
+    }
+
+    while (num > 0) {
+        str[i++] = (num % 10) + '0';
+        num /= 10;
+    }
+    str[i] = '\0';
+
+    int start = 0, end = i - 1;
+    while (start < end) {
+        char temp = str[start];
+        str[start] = str[end];
+        str[end] = temp;
+        start++;
+        end--;
+    }
+}
+
+static int failures = 0;
+
+static void expect(const char* what, const char* got, uint8_t len, const char* want)
+{
+    if (strcmp(got, want) != 0 || len != strlen(want)) {
+        if (failures++ < 20)
+            printf("FAIL %s: got \"%s\" (len %u), want \"%s\"\n", what, got, len, want);
+    }
+}
+
+static uint32_t rng_state = 12345;
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void check_u32(uint32_t v)
+{
+    char got[FMT_I32_MAX + 8], want[32];
+    uint8_t len;
+
+    snprintf(want, sizeof want, "%u", v);
+    len = fmt_u32(got, v);
+    expect("fmt_u32", got, len, want);
+
+    int32_t s = (int32_t)v;
+    snprintf(want, sizeof want, "%d", s);
+    len = fmt_i32(got, s);
+    expect("fmt_i32", got, len, want);
+
+    uint8_t width = v & 15;
+    snprintf(want, sizeof want, "%0*u", width, v);
+    len = fmt_u32_width(got, v, width, '0');
+    expect("fmt_u32_width 0", got, len, want);
+    snprintf(want, sizeof want, "%*u", width, v);
+    len = fmt_u32_width(got, v, width, ' ');
+    expect("fmt_u32_width ' '", got, len, want);
+
+    uint8_t frac = (v >> 4) % 10;
+    int64_t m = s < 0 ? -(int64_t)s : s;
+    int64_t p = 1;
+    for (uint8_t i = 0; i < frac; i++) p *= 10;
+    if (frac)
+        snprintf(want, sizeof want, "%s%lld.%0*lld", s < 0 ? "-" : "", (long long)(m / p), frac, (long long)(m % p));
+    else
+        snprintf(want, sizeof want, "%d", s);
+    char padded[40];
+    snprintf(padded, sizeof padded, "%*s", width, want);
+    len = fmt_fixed(got, s, frac, width);
+    expect("fmt_fixed", got, len, padded);
+}
+
+static void check_q(int32_t v, uint8_t q, uint8_t frac)
+{
+    char got[FMT_I32_MAX + 8], want[40];
+    double x = ldexp((double)v, -q);
+    double p = pow(10, frac);
+    double r = floor(fabs(x) * p + 0.5) / p;
+
+    if (r == 0) snprintf(want, sizeof want, "%.*f", frac, 0.0);
+    else snprintf(want, sizeof want, "%s%.*f", x < 0 ? "-" : "", frac, r);
+    uint8_t len = fmt_q(got, v, q, frac, 0);
+    expect("fmt_q", got, len, want);
+}
+
+int main(void)
+{
+    for (uint32_t v = 0; v < (1U << 24); v++) check_u32(v);
+    for (uint32_t k = 0; k < 32; k++) {
+        uint32_t base = 1U << k;
+        for (int32_t d = -3; d <= 3; d++) check_u32(base + (uint32_t)d);
+    }
+    for (uint32_t p = 1; p && p <= 1000000000U; p *= 10) {
+        check_u32(p - 1); check_u32(p); check_u32(p + 1);
+        check_u32(0U - p);
+    }
+    check_u32(0x7FFFFFFFU); check_u32(0x80000000U); check_u32(0xFFFFFFFFU);
+    for (uint32_t i = 0; i < 20000000; i++) check_u32(rng());
+
+    for (uint32_t i = 0; i < 2000000; i++) {
+        uint8_t q = rng() % 16;
+        uint8_t frac = rng() % 5;
+        int32_t v = (int32_t)(rng() >> (rng() % 12));
+        // keep the rounded result inside 32 bits
+        if (llabs((long long)v) * 10000LL >> q >= 0xFFFFFFFFLL) continue;
+        check_q(v, q, frac);
+    }
+    check_q(0x8000, 15, 3);
+    check_q(-1, 15, 3);
+
+    printf("correctness: %s (%d failures)\n", failures ? "FAIL" : "ok", failures);
+
+    // Speed: telemetry-sized values, then 32-bit timestamps
+    static const uint32_t ranges[] = { 1000, 100000000 };
+    char buf[FMT_U32_MAX];
+    volatile uint32_t sink = 0;
+    for (int r = 0; r < 2; r++) {
+        clock_t t0 = clock();
+        for (uint32_t i = 0; i < BENCH_ITER; i++) {
+            int_to_string(i % ranges[r] + (ranges[r] / 10), buf);
+            sink += buf[0];
+        }
+        clock_t t1 = clock();
+        for (uint32_t i = 0; i < BENCH_ITER; i++) {
+            fmt_u32(buf, i % ranges[r] + (ranges[r] / 10));
+            sink += buf[0];
+        }
+        clock_t t2 = clock();
+        printf("values < %9u: int_to_string %.1f ns, fmt_u32 %.1f ns\n", ranges[r] + ranges[r] / 10,
+               (double)(t1 - t0) / CLOCKS_PER_SEC * 1e9 / BENCH_ITER,
+               (double)(t2 - t1) / CLOCKS_PER_SEC * 1e9 / BENCH_ITER);
+    }
+    return failures ? 1 : 0;
+}
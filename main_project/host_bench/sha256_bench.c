@@ -0,0 +1,100 @@
+/*
+ * Host-side correctness and speed check for sha256.c
+ *
+ * Build and run from main_project/:
+ *   gcc -O2 -I. -o sha256_bench host_bench/sha256_bench.c sha256.c && ./sha256_bench
+ *
+ * Checks SHA-256 against the FIPS 180-2 examples and HMAC-SHA256 against
+ * RFC 4231. Every message is also fed one byte at a time, the way the
+ * firmware hashes frames as it queues them for the UART. The timing
+ * reports compressions per second, for comparing builds only.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "sha256.h"
+
+static int failures = 0;
+
+static void hex(const uint8_t* d, char* out)
+{
+    for (int i = 0; i < SHA256_DIGEST; i++) sprintf(out + 2 * i, "%02x", d[i]);
+}
+
+static void check(const char* what, const uint8_t* digest, const char* want)
+{
+    char got[2 * SHA256_DIGEST + 1];
+    hex(digest, got);
+    if (strcmp(got, want) != 0) {
+        failures++;
+        printf("FAIL %s:\n  got  %s\n  want %s\n", what, got, want);
+    }
+}
+
+static void check_sha(const char* what, const uint8_t* msg, size_t len, const char* want)
+{
+    Sha256Ctx ctx;
+    uint8_t d[SHA256_DIGEST];
+
+    sha256_init(&ctx);
+    sha256_update(&ctx, msg, len);
+    sha256_final(&ctx, d);
+    check(what, d, want);
+
+    sha256_init(&ctx);
+    for (size_t i = 0; i < len; i++) sha256_update(&ctx, msg + i, 1);
+    sha256_final(&ctx, d);
+    check(what, d, want);
+}
+
+static void check_hmac(const char* what, const uint8_t* key, size_t key_len,
+                       const char* msg, const char* want)
+{
+    HmacSha256Key k;
+    Sha256Ctx ctx;
+    uint8_t d[SHA256_DIGEST];
+
+    hmac_sha256_key(&k, key, key_len);
+    hmac_sha256_begin(&k, &ctx);
+    for (size_t i = 0; msg[i]; i++) sha256_update(&ctx, (const uint8_t*)msg + i, 1);
+    hmac_sha256_final(&k, &ctx, d);
+    check(what, d, want);
+}
+
+int main(void)
+{
+    static uint8_t million_a[1000000];
+    memset(million_a, 'a', sizeof million_a);
+
+    check_sha("empty", (const uint8_t*)"", 0,
+              "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    check_sha("abc", (const uint8_t*)"abc", 3,
+              "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    check_sha("448-bit", (const uint8_t*)"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56,
+              "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    check_sha("million a", million_a, sizeof million_a,
+              "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+    uint8_t key1[20], key6[131];
+    memset(key1, 0x0b, sizeof key1);
+    memset(key6, 0xaa, sizeof key6);
+    check_hmac("rfc4231 case 1", key1, sizeof key1, "Hi There",
+               "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7");
+    check_hmac("rfc4231 case 2", (const uint8_t*)"Jefe", 4, "what do ya want for nothing?",
+               "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+    check_hmac("rfc4231 case 6", key6, sizeof key6, "Test Using Larger Than Block-Size Key - Hash Key First",
+               "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+
+    printf("correctness: %s (%d failures)\n", failures ? "FAIL" : "ok", failures);
+
+    Sha256Ctx ctx;
+    uint8_t d[SHA256_DIGEST];
+    clock_t t0 = clock();
+    sha256_init(&ctx);
+    for (int r = 0; r < 20; r++) sha256_update(&ctx, million_a, sizeof million_a);
+    sha256_final(&ctx, d);
+    double s = (double)(clock() - t0) / CLOCKS_PER_SEC;
+    printf("%.0f ns per 64-byte block (digest %02x%02x...)\n", s * 1e9 / (20.0 * sizeof million_a / 64), d[0], d[1]);
+
+    return failures ? 1 : 0;
+}
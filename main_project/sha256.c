@@ -0,0 +1,127 @@
+#include <string.h>
+#include "sha256.h"
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t ror(uint32_t x, uint8_t n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+// 16-word rolling message schedule: 64 bytes of stack instead of 256
+static void sha256_block(uint32_t h[8], const uint8_t* p)
+{
+    uint32_t w[16];
+    for (uint8_t i = 0; i < 16; i++, p += 4) {
+        w[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+    uint32_t e = h[4], f = h[5], g = h[6], k = h[7];
+
+    for (uint8_t i = 0; i < 64; i++) {
+        uint32_t wi;
+        if (i < 16) {
+            wi = w[i];
+        } else {
+            uint32_t w15 = w[(i + 1) & 15], w2 = w[(i + 14) & 15];
+            uint32_t s0 = ror(w15, 7) ^ ror(w15, 18) ^ (w15 >> 3);
+            uint32_t s1 = ror(w2, 17) ^ ror(w2, 19) ^ (w2 >> 10);
+            wi = w[i & 15] += s0 + w[(i + 9) & 15] + s1;
+        }
+        uint32_t t1 = k + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + wi;
+        uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+void sha256_init(Sha256Ctx* ctx)
+{
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(ctx->h, iv, sizeof(iv));
+    ctx->bytes = 0;
+    ctx->fill = 0;
+}
+
+void sha256_update(Sha256Ctx* ctx, const uint8_t* data, size_t len)
+{
+    ctx->bytes += len;
+    while (len--) {
+        ctx->buf[ctx->fill++] = *data++;
+        if (ctx->fill == SHA256_BLOCK) {
+            sha256_block(ctx->h, ctx->buf);
+            ctx->fill = 0;
+        }
+    }
+}
+
+void sha256_final(Sha256Ctx* ctx, uint8_t out[SHA256_DIGEST])
+{
+    uint32_t bits_hi = ctx->bytes >> 29;
+    uint32_t bits_lo = ctx->bytes << 3;
+
+    ctx->buf[ctx->fill++] = 0x80;
+    if (ctx->fill > SHA256_BLOCK - 8) {
+        memset(ctx->buf + ctx->fill, 0, SHA256_BLOCK - ctx->fill);
+        sha256_block(ctx->h, ctx->buf);
+        ctx->fill = 0;
+    }
+    memset(ctx->buf + ctx->fill, 0, SHA256_BLOCK - 8 - ctx->fill);
+    for (uint8_t i = 0; i < 4; i++) {
+        ctx->buf[56 + i] = (uint8_t)(bits_hi >> (24 - 8 * i));
+        ctx->buf[60 + i] = (uint8_t)(bits_lo >> (24 - 8 * i));
+    }
+    sha256_block(ctx->h, ctx->buf);
+
+    for (uint8_t i = 0; i < 8; i++) {
+        out[4 * i]     = (uint8_t)(ctx->h[i] >> 24);
+        out[4 * i + 1] = (uint8_t)(ctx->h[i] >> 16);
+        out[4 * i + 2] = (uint8_t)(ctx->h[i] >> 8);
+        out[4 * i + 3] = (uint8_t)ctx->h[i];
+    }
+}
+
+void hmac_sha256_key(HmacSha256Key* k, const uint8_t* key, size_t len)
+{
+    uint8_t block[SHA256_BLOCK] = {0};
+
+    if (len > SHA256_BLOCK) {
+        sha256_init(&k->inner);
+        sha256_update(&k->inner, key, len);
+        sha256_final(&k->inner, block);
+    } else {
+        memcpy(block, key, len);
+    }
+
+    for (uint8_t i = 0; i < SHA256_BLOCK; i++) block[i] ^= 0x36;
+    sha256_init(&k->inner);
+    sha256_update(&k->inner, block, SHA256_BLOCK);
+
+    for (uint8_t i = 0; i < SHA256_BLOCK; i++) block[i] ^= 0x36 ^ 0x5c;
+    sha256_init(&k->outer);
+    sha256_update(&k->outer, block, SHA256_BLOCK);
+}
+
+void hmac_sha256_final(const HmacSha256Key* k, Sha256Ctx* ctx, uint8_t out[SHA256_DIGEST])
+{
+    uint8_t inner[SHA256_DIGEST];
+    sha256_final(ctx, inner);
+    *ctx = k->outer;
+    sha256_update(ctx, inner, SHA256_DIGEST);
+    sha256_final(ctx, out);
+}
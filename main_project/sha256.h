@@ -0,0 +1,35 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ================== SHA-256 / HMAC-SHA256 ================== */
+// Streaming: data may arrive one byte at a time (e.g. as it is queued for
+// the UART); a block is compressed as soon as 64 bytes are buffered.
+#define SHA256_BLOCK   64
+#define SHA256_DIGEST  32
+
+typedef struct {
+    uint32_t h[8];
+    uint32_t bytes;                 // total length so far (frames stay far below 512 MB)
+    uint8_t buf[SHA256_BLOCK];
+    uint8_t fill;
+} Sha256Ctx;
+
+void sha256_init(Sha256Ctx* ctx);
+void sha256_update(Sha256Ctx* ctx, const uint8_t* data, size_t len);
+void sha256_final(Sha256Ctx* ctx, uint8_t out[SHA256_DIGEST]);
+
+// Key-dependent ipad/opad states, hashed once per key (saves two block
+// compressions on every message)
+typedef struct {
+    Sha256Ctx inner;
+    Sha256Ctx outer;
+} HmacSha256Key;
+
+void hmac_sha256_key(HmacSha256Key* k, const uint8_t* key, size_t len);
+static inline void hmac_sha256_begin(const HmacSha256Key* k, Sha256Ctx* ctx) { *ctx = k->inner; }
+void hmac_sha256_final(const HmacSha256Key* k, Sha256Ctx* ctx, uint8_t out[SHA256_DIGEST]);
+
+#endif
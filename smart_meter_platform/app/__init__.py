@@ -1,162 +1,286 @@
 import threading
 import time
 import os
+import atexit
 import logging
+from collections import deque
+from dataclasses import replace, asdict
 from flask import Flask
 from flask_cors import CORS
-from app.utils import load_sensor_logs, convert_json_to_meter_reading
+from app.utils import SensorLogReader, convert_json_to_meter_reading
 from app.models import AIPrediction, MeterReading
 from app.ai_model import AlertClassifier
+from app.history import history
 from app.pid_controller import simulation 
+from app.state import store, LOG_TAIL
+from app.tracing import tracer
 
 # Configure logging
 logging.basicConfig(level=logging.INFO)
 
-# Global in-memory database
-db = {
-    "meter_readings": {},
-    "predictions": [],
-    "json_data": [],
-    "last_processed_index": 0,
-    "last_file_size": 0,
-    "alert_stats": {  # NEW: Track alert statistics
-        'total_processed': 0,
-        'by_type': {},
-        'by_node': {}
-    }
-}
 predictive_model = None
 
+# Where the log replay in initialize_data() stopped: the last TIME_STEPS
+# entries and entry count per node, plus the alerts derived so far. Lets
+# a changed log be processed from where it left off, and is what the
+# fast-start snapshot stores for the next start.
+replay = None
+SNAPSHOT_INTERVAL = 60      # seconds between snapshot writes while state changes
+
 def get_data_path():
     """Returns the absolute path to sensor_logs.json in the project root."""
     base_dir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
     return os.path.join(base_dir, 'sensor_logs.json')
 
+# The log as read so far. Private to this process's background thread;
+# requests read published snapshots from `store` instead. Every process
+# reads only what was appended since its last read. The writer holds raw
+# entries only until initialize_data() has replayed them, plus the last
+# LOG_TAIL for /api/logs.
+loader = {
+    "log": SensorLogReader(get_data_path()),
+    "pending": [],          # writer: entries read but not replayed yet
+    "pending_start": 0,     # log index of pending[0]
+    "marker": None,         # timestamp of the entry just before pending[0]
+    "tail": deque(maxlen=LOG_TAIL),
+    "total": 0,             # entries in the log
+    "traced": 0             # log entries handed to the tracer
+}
+
 def create_app():
-    global predictive_model
     app = Flask(__name__, template_folder='../templates', static_folder='../static')
     CORS(app)
     
     from . import routes
     app.register_blueprint(routes.bp)
 
-    with app.app_context():
-        # Setup Paths
-        data_path = get_data_path()
-        model_path = os.path.join(app.root_path, 'lstm_multiclass_classifier.h5')
+    store.attach()
+    # A reader that outlives the writer takes over its job
+    store.on_promote = lambda: threading.Thread(target=promoted_writer, args=(app,), daemon=True).start()
 
-        # Use enhanced AlertClassifier
-        predictive_model = AlertClassifier(model_path=model_path, data_path=data_path)
-        
+    with app.app_context():
         # Initial load
+        start = time.perf_counter()
         reload_json_data()
-        initialize_data()
+        if store.is_writer:
+            start_writer(app)
+            print(f"🚀 Serving after {time.perf_counter() - start:.2f}s")
 
-    thread = threading.Thread(target=background_update, args=(app,), daemon=True)
+    # Readers only keep their local history index fresh; the writer owns the state
+    target = background_update if store.is_writer else background_history
+    thread = threading.Thread(target=target, args=(app,), daemon=True)
     thread.start()
     
     return app
 
+def start_writer(app):
+    """Build the model and publish the first state; the writer process only."""
+    global predictive_model
+    with app.app_context():
+        # Setup Paths
+        data_path = get_data_path()
+        model_path = os.path.join(app.root_path, 'lstm_multiclass_classifier.h5')
+        snapshot_path = os.path.join(app.root_path, 'model_snapshot.bin')
+
+        # Use enhanced AlertClassifier; restores from the snapshot when it can
+        # and loads/trains the LSTM in the background otherwise
+        predictive_model = AlertClassifier(model_path=model_path, data_path=data_path,
+                                           snapshot_path=snapshot_path)
+        initialize_data(resume=load_replay_state(predictive_model.replay_state))
+        save_snapshot()
+        atexit.register(save_snapshot)
+
+def promoted_writer(app):
+    """A reader took over the shared segment after the writer died."""
+    print(f"STATE: pid {os.getpid()} is now the writer")
+    # A reader kept no raw entries: read the whole log once for the replay
+    loader["log"].rewind()
+    reload_json_data()
+    start_writer(app)
+    background_update(app)
+
 def reload_json_data():
-    """Reloads sensor data from the JSON file."""
-    data_path = get_data_path()
+    """Reads the entries appended to the log since the last call; True if any."""
     try:
-        if os.path.exists(data_path):
-            file_size = os.path.getsize(data_path)
-            # Reload if file changed OR if memory is empty
-            if file_size != db["last_file_size"] or not db["json_data"]:
-                data = load_sensor_logs(data_path)
-                if data:
-                    db["json_data"] = data
-                    db["last_file_size"] = file_size
-                    print(f"DISK: Loaded {len(db['json_data'])} entries from log file.")
-                    return True
+        entries, start = loader["log"].read()
     except Exception as e:
         print(f"Error reloading data: {e}")
-    return False
+        return False
+    if not entries:
+        return False
+
+    if start == 0:
+        history.reset()
+    history.ingest(entries)
+    loader["total"] = start + len(entries)
+    if store.is_writer:
+        if start == 0:
+            loader.update(pending=[], pending_start=0, marker=None)
+            loader["tail"].clear()
+        loader["pending"].extend(entries)
+        loader["tail"].extend(entries)
+    if predictive_model:
+        predictive_model.observe_log(entries)
+        # Entries the tracer already saw come round again after a rewind
+        seen = loader["traced"] - start
+        tracer.loaded(entries[seen:] if 0 <= seen <= len(entries) else entries)
+        loader["traced"] = start + len(entries)
+    print(f"DISK: Read {len(entries)} entries from log file ({start + len(entries)} total).")
+    return True
+
+def new_replay_state():
+    return {
+        "windows": {},          # node_id -> deque of the last TIME_STEPS raw entries
+        "counts": {},           # node_id -> entries replayed for that node
+        "entries": 0,           # log entries consumed
+        "marker": None,         # timestamp of the last consumed entry
+        "predictions": [],
+        "alert_stats": {'total_processed': 0, 'by_type': {}, 'by_node': {}}
+    }
+
+def dump_replay_state(state):
+    """JSON-able copy of a replay state for the snapshot file."""
+    return dict(state,
+                windows={nid: list(w) for nid, w in state["windows"].items()},
+                predictions=[asdict(p) for p in state["predictions"]])
 
-def initialize_data():
+def load_replay_state(saved):
+    """Inverse of dump_replay_state(); None if missing or malformed."""
+    if not saved:
+        return None
+    try:
+        state = new_replay_state()
+        state.update(saved)
+        state["windows"] = {nid: deque(w, maxlen=predictive_model.TIME_STEPS)
+                            for nid, w in saved["windows"].items()}
+        state["predictions"] = [AIPrediction(**p) for p in saved["predictions"]]
+        return state
+    except Exception as e:
+        print(f"Replay state in snapshot ignored: {e}")
+        return None
+
+def _resumable(state):
+    """True if the state's last consumed entry is still where it left it."""
+    n, start, pending = state["entries"], loader["pending_start"], loader["pending"]
+    if n == 0 or n < start or n > start + len(pending):
+        return False
+    last = pending[n - start - 1].get('timestamp') if n > start else loader["marker"]
+    return last == state["marker"]
+
+def save_snapshot():
+    """Writer only: persist model, baselines and replay state for a fast restart."""
+    if predictive_model and replay is not None:
+        predictive_model.save_snapshot(dump_replay_state(replay))
+
+def initialize_data(resume=None, full=False):
     """
-    ENHANCED: Processes loaded JSON data with intelligent alert classification
+    ENHANCED: Processes loaded JSON data with intelligent alert classification.
+    Continues from the replay state when the log only grew; replays it all
+    otherwise (or when full=True).
     """
-    if not db["json_data"]:
+    global replay
+    if not loader["total"]:
         return
 
     try:
-        sorted_data = sorted(db["json_data"], key=lambda x: x.get('timestamp', ''))
-        
-        # 1. Update Latest State (For Dashboard Cards)
-        node_latest = {}
-        for entry in sorted_data:
-            nid = entry.get('node_id')
-            if nid:
-                node_latest[nid] = entry
-        
-        for nid, entry in node_latest.items():
-            reading = convert_json_to_meter_reading(entry)
-            db["meter_readings"][nid] = reading
+        state = resume if resume is not None else replay
+        if full or state is None or not _resumable(state):
+            if loader["pending_start"]:
+                # Replayed entries are not kept: read the log again
+                loader["log"].rewind()
+                reload_json_data()
+            state = new_replay_state()
+        pending, start = loader["pending"], loader["pending_start"]
+        new_entries = sorted(pending[state["entries"] - start:], key=lambda x: x.get('timestamp', ''))
         
-        # 2. ENHANCED HISTORICAL ALERTS PROCESSING
-        db["predictions"] = []
-        db["alert_stats"]['by_type'] = {}
-        db["alert_stats"]['by_node'] = {}
+        # Built privately, then published as one snapshot below
+        predictions = list(state["predictions"])
+        alert_stats = state["alert_stats"]
+        windows, counts = state["windows"], state["counts"]
+        traced = []
         
-        # Group data by node for context-aware processing
-        by_node = {}
-        for entry in sorted_data:
-            nid = entry.get('node_id', 'UNKNOWN')
-            if nid not in by_node:
-                by_node[nid] = []
-            by_node[nid].append(entry)
-        
-        # Process each node's history
-        for node_id, entries in by_node.items():
-            # Process in chronological windows
-            for i in range(len(entries)):
-                entry = entries[i]
-                
-                # Get context window (last N readings)
-                start_idx = max(0, i - predictive_model.TIME_STEPS + 1)
-                context_entries = entries[start_idx:i+1]
-                context_readings = [convert_json_to_meter_reading(e) for e in context_entries]
-                
-                # Only process if we have anomaly indicator OR sufficient history
-                has_tamper_flag = entry.get('tamperFlag') == 1
-                has_history = len(context_readings) >= predictive_model.TIME_STEPS
+        # ENHANCED HISTORICAL ALERTS PROCESSING, node by node in time order
+        for entry in new_entries:
+            node_id = entry.get('node_id', 'UNKNOWN')
+            window = windows.setdefault(node_id, deque(maxlen=predictive_model.TIME_STEPS))
+            window.append(entry)
+            i = counts.get(node_id, 0)
+            counts[node_id] = i + 1
+            
+            # Context window (last N readings)
+            context_readings = [convert_json_to_meter_reading(e) for e in window]
+            
+            # Only process if we have anomaly indicator OR sufficient history
+            has_tamper_flag = entry.get('tamperFlag') == 1
+            has_history = len(context_readings) >= predictive_model.TIME_STEPS
+            
+            pred = None
+            if has_tamper_flag or (has_history and i % 20 == 0):  # Sample every 20th for efficiency
+                result = predictive_model.get_health_score_and_prediction(
+                    node_id, 
+                    context_readings
+                )
                 
-                if has_tamper_flag or (has_history and i % 20 == 0):  # Sample every 20th for efficiency
-                    result = predictive_model.get_health_score_and_prediction(
-                        node_id, 
-                        context_readings
-                    )
+                if result.get('prediction'):
+                    pred = result['prediction']
+                    # Override timestamp with actual data timestamp
+                    pred.timestamp = entry.get('timestamp')
+                    pred.capture_id = entry.get('capture_id')
                     
-                    if result.get('prediction'):
-                        pred = result['prediction']
-                        # Override timestamp with actual data timestamp
-                        pred.timestamp = entry.get('timestamp')
-                        
-                        db["predictions"].append(pred)
-                        
-                        # Update stats
-                        alert_type = result.get('alert_type', 'UNKNOWN')
-                        db["alert_stats"]['by_type'][alert_type] = \
-                            db["alert_stats"]['by_type'].get(alert_type, 0) + 1
-                        
-                        if node_id not in db["alert_stats"]['by_node']:
-                            db["alert_stats"]['by_node'][node_id] = 0
-                        db["alert_stats"]['by_node'][node_id] += 1
+                    predictions.append(pred)
+                    
+                    # Update stats
+                    alert_type = result.get('alert_type', 'UNKNOWN')
+                    alert_stats['by_type'][alert_type] = \
+                        alert_stats['by_type'].get(alert_type, 0) + 1
+                    
+                    if node_id not in alert_stats['by_node']:
+                        alert_stats['by_node'][node_id] = 0
+                    alert_stats['by_node'][node_id] += 1
+
+            classified_at = tracer.classified(entry)
+            if pred is not None and entry.get('trace'):
+                pred.trace = dict(entry['trace'], classified=classified_at)
+                traced.append(pred)
         
         # Sort by timestamp (newest first) and limit
-        db["predictions"].sort(key=lambda x: x.timestamp, reverse=True)
-        db["predictions"] = db["predictions"][:100]  # Keep last 100
+        predictions.sort(key=lambda x: x.timestamp, reverse=True)
+        predictions = predictions[:100]  # Keep last 100
+        alert_stats['total_processed'] = len(predictions)
         
-        db["last_processed_index"] = len(db["json_data"])
-        db["alert_stats"]['total_processed'] = len(db["predictions"])
+        total = start + len(pending)
+        marker = pending[-1].get('timestamp') if pending else loader["marker"]
+        state.update(predictions=predictions, entries=total, marker=marker)
+        replay = state
+        loader.update(pending=[], pending_start=total, marker=marker)
+        
+        # Latest State (For Dashboard Cards)
+        meter_readings = dict(store.current().meter_readings)
+        for nid, window in windows.items():
+            if window[-1].get('node_id'):
+                meter_readings[nid] = convert_json_to_meter_reading(window[-1])
+        
+        published_at = tracer.published()
+        for pred in traced:
+            pred.trace['published'] = published_at
+
+        snap = store.publish(
+            meter_readings=meter_readings,
+            predictions=tuple(predictions),
+            alert_stats=dict(alert_stats, by_type=dict(alert_stats['by_type']),
+                             by_node=dict(alert_stats['by_node'])),
+            json_tail=tuple(loader["tail"]),
+            total_records=total,
+            last_processed_index=total,
+            latency=tracer.summary()
+        )
         
-        print(f"✅ Initialized {len(db['predictions'])} alerts across {len(node_latest)} nodes")
-        print(f"   Alert distribution: {db['alert_stats']['by_type']}")
+        print(f"✅ Initialized {len(predictions)} alerts across {len(windows)} nodes "
+              f"({len(new_entries)} entries replayed, state v{snap.version})")
+        print(f"   Alert distribution: {alert_stats['by_type']}")
         
     except Exception as e:
+        replay = None   # possibly half-advanced; replay from scratch next time
         print(f"INIT ERROR: {e}")
         import traceback
         traceback.print_exc()
@@ -165,33 +289,31 @@ def update_predictions_and_health(node_id):
     """
     ENHANCED: Updates AI prediction with multi-class classification
     """
-    if not predictive_model or not db["json_data"]:
+    if not predictive_model or replay is None:
         return
 
     time_steps = predictive_model.TIME_STEPS
-    node_history = [x for x in db["json_data"] if x.get('node_id') == node_id]
+    # The replay keeps the last TIME_STEPS entries of every node
+    recent_items = replay["windows"].get(node_id)
     
-    if not node_history:
+    if not recent_items:
         return
 
-    recent_items = node_history[-time_steps:]
     recent_readings = [convert_json_to_meter_reading(item) for item in recent_items]
 
-    # Set Default
-    if node_id in db["meter_readings"]:
-        db["meter_readings"][node_id].health_score = 100
+    # Copy-on-write: published readings are never modified in place
+    snap = store.current()
+    meter_readings = dict(snap.meter_readings)
+    predictions = snap.predictions
+    health_score = 100
 
     if len(recent_readings) >= time_steps:
         result = predictive_model.get_health_score_and_prediction(node_id, recent_readings)
-        
-        # Update health score
-        if node_id in db["meter_readings"]:
-            db["meter_readings"][node_id].health_score = result["health_score"]
+        health_score = result["health_score"]
 
         # Add new prediction if exists
         if result["prediction"]:
-            db["predictions"].insert(0, result["prediction"])
-            db["predictions"] = db["predictions"][:100]  # Keep last 100
+            predictions = ((result["prediction"],) + predictions)[:100]  # Keep last 100
             
             # Trigger PID disturbance for critical alerts
             alert_type = result.get("alert_type", "")
@@ -200,21 +322,60 @@ def update_predictions_and_health(node_id):
                 simulation.trigger_disturbance()
                 print(f"🚨 Critical alert triggered PID disturbance: {alert_type}")
 
+    if node_id in meter_readings:
+        meter_readings[node_id] = replace(meter_readings[node_id], health_score=health_score)
+    store.publish(meter_readings=meter_readings, predictions=predictions)
+
+def publish_pid_history():
+    """Copy the simulation history into the snapshot; the live lists keep changing."""
+    history_now = simulation.get_history()
+    store.publish(pid_history={k: list(v) for k, v in history_now.items()})
+
 def background_update(app):
-    """Real-time data watcher loop with intelligent update batching"""
+    """Real-time data watcher loop with intelligent update batching.
+    The only writer of published state in the whole deployment."""
     update_counter = 0
+    saved_model_version = predictive_model.model_version if predictive_model else 0
+    last_snapshot = time.time()
+    dirty = False
     while True:
         time.sleep(1) 
         update_counter += 1
         
         with app.app_context():
             simulation.step()
+            publish_pid_history()
             
-            # Check for new data
-            if reload_json_data():
-                # Full re-initialization on data change
+            # Check for new data (or a reload requested by any worker)
+            if store.take_reinit_request():
+                # Log regenerated: replay it from scratch
+                loader["log"].rewind()
+                reload_json_data()
+                initialize_data(full=True)
+                dirty = True
+            elif reload_json_data():
+                # Log grew: continue the replay from where it stopped
                 initialize_data()
+                dirty = True
             elif update_counter % 10 == 0:
                 # Periodic health score updates for active nodes (every 10 seconds)
-                for node_id in list(db["meter_readings"].keys())[:3]:  # Update top 3
+                for node_id in list(store.current().meter_readings.keys())[:3]:  # Update top 3
                     update_predictions_and_health(node_id)
+            
+            # Snapshot as soon as a background-trained model lands, else periodically
+            if predictive_model:
+                if predictive_model.model_version != saved_model_version or \
+                        (dirty and time.time() - last_snapshot >= SNAPSHOT_INTERVAL):
+                    saved_model_version = predictive_model.model_version
+                    save_snapshot()
+                    last_snapshot = time.time()
+                    dirty = False
+
+def background_history(app):
+    """Reader workers: keep the local time index in step with the log file.
+    Also checks the writer is alive when no requests are coming in."""
+    while not store.is_writer:
+        time.sleep(1)
+        store.current()
+        with app.app_context():
+            reload_json_data()
@@ -1,13 +1,14 @@
 import numpy as np
-import pandas as pd
-from tensorflow.keras.models import Model, load_model
-from tensorflow.keras.layers import Input, LSTM, Dense, Dropout, BatchNormalization
-from sklearn.preprocessing import StandardScaler, LabelEncoder
-from sklearn.model_selection import train_test_split
 import os
 import json
+import atexit
+import threading
+import time
 from datetime import datetime, timedelta
 from app.models import MeterReading, AIPrediction
+from app.baselines import BaselineStore, FLEET
+from app import snapshot
+from app.snapshot import FrozenModel, FrozenScaler
 from collections import defaultdict
 
 class AlertClassifier:
@@ -119,21 +120,29 @@ class AlertClassifier:
         }
     }
 
-    def __init__(self, model_path='app/lstm_multiclass_classifier.h5', data_path='sensor_logs.json'):
+    # Feature columns the model and scaler were fitted on, in order
+    FEATURES = ['voltage', 'current', 'lightIntensity']
+
+    def __init__(self, model_path='app/lstm_multiclass_classifier.h5', data_path='sensor_logs.json',
+                 snapshot_path=None):
         self.model_path = model_path
         self.data_path = data_path
-        self.scaler = StandardScaler()
-        self.label_encoder = LabelEncoder()
+        self.snapshot_path = snapshot_path
+        self.scaler = None
         self.TIME_STEPS = 10
         self.n_features = 3
         self.n_classes = len(self.ALERT_TYPES)
         
         # NEW: Auto-learned baselines from your actual data
+        # (fleet-wide; per-node baselines take over once a node has history)
         self.baselines = {
             'voltage': {'min': 200, 'max': 245, 'mean': 220, 'std': 10},
             'current': {'min': 1, 'max': 12, 'mean': 5, 'std': 3},
             'light': {'min': 20, 'max': 150, 'mean': 60, 'std': 30}  # CALIBRATED to your data
         }
+        baseline_path = os.path.join(os.path.dirname(os.path.abspath(data_path)), 'baselines.json')
+        self.node_baselines = BaselineStore(path=baseline_path, defaults=dict(self.baselines))
+        atexit.register(self.node_baselines.save)
         
         # Performance optimization
         self._prediction_cache = {}
@@ -143,52 +152,47 @@ class AlertClassifier:
         self._recent_alerts = defaultdict(int)
         self._diversity_boost = True  # Encourage varied classifications
         
-        self.model = self._load_or_train_model()
-        self._learn_baselines()  # Auto-calibrate from data
+        # Model state. TensorFlow and scikit-learn are only imported by the
+        # background training job; serving uses numpy copies of the weights.
+        self.model = None
+        self.model_version = 0          # bumped whenever self.model is replaced
+        self.replay_state = None        # caller's replay state from the snapshot
+        self._model_source_mtime = None
+        self._training = None
+        
+        restored = self.restore_snapshot()
+        self._learn_baselines()  # Auto-calibrate first: training labels use the baselines
+        if not restored or self._model_file_newer():
+            self.retrain_async()
 
     def _learn_baselines(self):
         """
-        AUTO-CALIBRATION: Learn actual sensor baselines from historical data
-        This fixes the light intensity threshold issue!
+        AUTO-CALIBRATION: Per-node streaming baselines (Welford + P² quantiles).
+        Restores the persisted state, then learns only log entries newer than it.
         """
-        if not os.path.exists(self.data_path):
-            return
+        restored = self.node_baselines.load()
         
         try:
-            with open(self.data_path, 'r') as f:
-                data = json.load(f)
-            
-            df = pd.DataFrame(data)
-            
-            # Learn from NORMAL operations only
-            normal_data = df[df['tamperFlag'] == 0]
-            
-            if len(normal_data) > 10:
-                for sensor in ['voltage', 'current']:
-                    values = normal_data[sensor].values
-                    self.baselines[sensor] = {
-                        'min': float(np.percentile(values, 5)),
-                        'max': float(np.percentile(values, 95)),
-                        'mean': float(np.mean(values)),
-                        'std': float(np.std(values))
-                    }
-                
-                # Special handling for light (your data shows low ambient)
-                light_values = normal_data['lightIntensity'].values
-                self.baselines['light'] = {
-                    'min': float(np.percentile(light_values, 5)),
-                    'max': float(np.percentile(light_values, 95)),
-                    'mean': float(np.mean(light_values)),
-                    'std': float(np.std(light_values))
-                }
-                
-                print(f"📊 AUTO-CALIBRATED BASELINES:")
-                print(f"   Voltage: {self.baselines['voltage']['mean']:.1f}V ± {self.baselines['voltage']['std']:.1f}")
-                print(f"   Current: {self.baselines['current']['mean']:.1f}A ± {self.baselines['current']['std']:.1f}")
-                print(f"   Light: {self.baselines['light']['mean']:.1f} lux ± {self.baselines['light']['std']:.1f}")
-                
+            learned = 0
+            if os.path.exists(self.data_path):
+                with open(self.data_path, 'r') as f:
+                    learned = self.node_baselines.ingest(json.load(f))
+                self.node_baselines.save()
         except Exception as e:
             print(f"Baseline learning failed: {e}. Using defaults.")
+            return
+        
+        self.baselines = self.node_baselines.get(FLEET)
+        nodes = len([n for n in self.node_baselines.nodes if n != FLEET])
+        print(f"📊 AUTO-CALIBRATED BASELINES ({nodes} nodes, {'restored + ' if restored else ''}{learned} new readings):")
+        print(f"   Voltage: {self.baselines['voltage']['mean']:.1f}V ± {self.baselines['voltage']['std']:.1f}")
+        print(f"   Current: {self.baselines['current']['mean']:.1f}A ± {self.baselines['current']['std']:.1f}")
+        print(f"   Light: {self.baselines['light']['mean']:.1f} lux ± {self.baselines['light']['std']:.1f}")
+
+    def observe_log(self, entries):
+        """Feed newly logged readings into the streaming baselines (O(1) each)."""
+        if self.node_baselines.ingest(entries):
+            self.baselines = self.node_baselines.get(FLEET)
 
     def _calculate_anomaly_scores(self, readings: list) -> dict:
         """
@@ -196,24 +200,25 @@ class AlertClassifier:
         Returns separate scores for each sensor + patterns
         """
         if not readings:
-            return {'voltage': 0, 'current': 0, 'light': 0, 'pattern': 0}
+            return {'voltage': 0, 'current': 0, 'light': 0, 'pattern': 0, 'spectral': 0}
         
         latest = readings[-1]
         v, c, l = latest.voltage, latest.current, latest.light
+        baselines = self.node_baselines.get(latest.node_id)
         
         scores = {}
         
         # Voltage anomaly score (0-100)
-        v_dev = abs(v - self.baselines['voltage']['mean']) / self.baselines['voltage']['std']
+        v_dev = abs(v - baselines['voltage']['mean']) / baselines['voltage']['std']
         scores['voltage'] = min(100, v_dev * 30)
         
         # Current anomaly score
-        c_dev = abs(c - self.baselines['current']['mean']) / self.baselines['current']['std']
+        c_dev = abs(c - baselines['current']['mean']) / baselines['current']['std']
         scores['current'] = min(100, c_dev * 30)
         
-        # Light anomaly score (calibrated to YOUR baseline)
-        l_mean = self.baselines['light']['mean']
-        l_std = max(self.baselines['light']['std'], 10)  # Minimum std to avoid division issues
+        # Light anomaly score (calibrated to this node's baseline)
+        l_mean = baselines['light']['mean']
+        l_std = max(baselines['light']['std'], 10)  # Minimum std to avoid division issues
         
         # Light spike detection (relative to YOUR baseline, not hardcoded 500)
         if l > l_mean + (3 * l_std):  # 3 sigma = unusual
@@ -237,8 +242,28 @@ class AlertClassifier:
         else:
             scores['pattern'] = 0
         
+        # Spectral anomaly: a healthy resistive load stays under ~5% THD.
+        # A simulated waveform is built from the tamper/magnet flags, so its
+        # THD is no evidence of its own and scores nothing
+        thd = latest.thd if latest.thd is not None and latest.harmonics_measured else 0
+        scores['spectral'] = min(100, max(0, thd - 5) * 4)
+        
         return scores
 
+    def _harmonic_ratios(self, reading) -> tuple:
+        """
+        Odd (h3,h5,h7) and even (h2,h4,h6,h8) harmonic content relative to
+        the fundamental. Rectifier/hook loads inject odd harmonics; a CT driven
+        into saturation by an external magnet shows up as even harmonics.
+        Zero unless the harmonics came from a sampled CT window.
+        """
+        h = reading.harmonics
+        if not reading.harmonics_measured or not h or len(h) < 8 or h[0] <= 0:
+            return 0.0, 0.0
+        odd = np.sqrt(h[2]**2 + h[4]**2 + h[6]**2) / h[0]
+        even = np.sqrt(h[1]**2 + h[3]**2 + h[5]**2 + h[7]**2) / h[0]
+        return float(odd), float(even)
+
     def _classify_rule_based_enhanced(self, readings: list) -> tuple:
         """
         ENHANCED: Rule-based classification with anomaly scoring
@@ -249,6 +274,7 @@ class AlertClassifier:
         
         latest = readings[-1]
         v, c, l = latest.voltage, latest.current, latest.light
+        baselines = self.node_baselines.get(latest.node_id)
         
         scores = self._calculate_anomaly_scores(readings)
         context = {
@@ -262,8 +288,9 @@ class AlertClassifier:
         # Calculate composite anomaly score
         total_score = sum(scores.values())
         
-        # Multi-sensor detection (highest priority)
-        active_sensors = sum(1 for score in scores.values() if score > 30)
+        # Multi-sensor detection (highest priority). Harmonics follow every
+        # tamper the firmware sees, so the spectral score is not a sensor here
+        active_sensors = sum(1 for name, score in scores.items() if name != 'spectral' and score > 30)
         if active_sensors >= 2:
             context['triggers'].append('multi_sensor')
             if total_score > 200:
@@ -276,8 +303,13 @@ class AlertClassifier:
             confidence = 78 + min(18, scores['light'] / 3)
             return 2, confidence, context
         
+        # Harmonic content from the on-device FFT corroborates the sensor rules
+        # below; on its own it only decides once they have all passed. Both
+        # ratios are zero for simulated waveforms (see _harmonic_ratios)
+        odd_ratio, even_ratio = self._harmonic_ratios(latest)
+        
         # Voltage manipulation
-        v_baseline = self.baselines['voltage']
+        v_baseline = baselines['voltage']
         if v < v_baseline['min'] or v > v_baseline['max']:
             context['triggers'].append('voltage_abnormal')
             severity = abs(v - v_baseline['mean']) / v_baseline['std']
@@ -285,10 +317,13 @@ class AlertClassifier:
             return 6, confidence, context
         
         # Current bypass / hooking (high current)
-        c_baseline = self.baselines['current']
+        c_baseline = baselines['current']
         if c > c_baseline['mean'] + (2.5 * c_baseline['std']):  # 2.5 sigma
             context['triggers'].append('overcurrent')
             confidence = 72 + min(23, (c - c_baseline['mean']) * 2)
+            if odd_ratio > 0.15:
+                context['triggers'].append('harmonic_signature')
+                confidence = min(97, confidence + 5)
             return 5, confidence, context
         
         # Magnetic bypass (low current + normal voltage)
@@ -300,6 +335,9 @@ class AlertClassifier:
             base_conf = 70 + min(20, (c_baseline['mean'] - c) * 4)
             if self._diversity_boost and self._recent_alerts.get('MAGNETIC_BYPASS_ATTEMPT', 0) > 3:
                 base_conf -= 10  # Reduce confidence to allow other classifications
+            if even_ratio > 0.10:
+                context['triggers'].append('ct_saturation')
+                base_conf += 5
             return 3, max(60, base_conf), context
         
         # Thermal / Overload
@@ -307,6 +345,14 @@ class AlertClassifier:
             context['triggers'].append('thermal_stress')
             return 4, 68 + min(24, scores['current']/2), context
         
+        # Harmonic signatures with no other sensor out of range
+        if even_ratio > 0.10:
+            context['triggers'].append('ct_saturation')
+            return 3, 74 + min(22, even_ratio * 60), context
+        if odd_ratio > 0.15:
+            context['triggers'].append('harmonic_signature')
+            return 5, 74 + min(22, odd_ratio * 50), context
+        
         # Load anomaly (moderate deviations)
         if total_score > 40 and total_score < 100:
             context['triggers'].append('load_deviation')
@@ -323,15 +369,18 @@ class AlertClassifier:
 
     def _load_data_for_training(self):
         """Load and preprocess with enhanced labeling"""
+        import pandas as pd
+        from sklearn.preprocessing import StandardScaler
+        
         if not os.path.exists(self.data_path):
-            return None, None
+            return None, None, None
         
         with open(self.data_path, 'r') as f:
             data = json.load(f)
             
         df = pd.DataFrame(data)
         if 'timestamp' not in df.columns:
-            return None, None
+            return None, None, None
             
         df['timestamp'] = pd.to_datetime(df['timestamp'])
         df = df.sort_values('timestamp')
@@ -341,10 +390,11 @@ class AlertClassifier:
         for idx, row in df.iterrows():
             v, c, l = row['voltage'], row['current'], row['lightIntensity']
             
-            # Use learned baselines for classification
-            v_baseline = self.baselines['voltage']
-            c_baseline = self.baselines['current']
-            l_baseline = self.baselines['light']
+            # Use learned baselines for classification (per node where known)
+            baselines = self.node_baselines.get(row.get('node_id'))
+            v_baseline = baselines['voltage']
+            c_baseline = baselines['current']
+            l_baseline = baselines['light']
             
             # Multi-sensor check
             anomalies = 0
@@ -375,14 +425,15 @@ class AlertClassifier:
         
         df['alert_class'] = labels
         
-        features = df[['voltage', 'current', 'lightIntensity']].values
+        features = df[self.FEATURES].values
         labels = df['alert_class'].values
         
-        self.scaler.fit(features)
-        scaled_features = self.scaler.transform(features)
-        self.label_encoder.fit(labels)
+        # Fitted privately; swapped in together with the model it belongs to
+        scaler = StandardScaler()
+        scaler.fit(features)
+        scaled_features = scaler.transform(features)
         
-        return scaled_features, labels
+        return scaled_features, labels, scaler
 
     def _create_sequences(self, features, labels):
         """Create LSTM sequences"""
@@ -394,6 +445,9 @@ class AlertClassifier:
 
     def _build_model(self):
         """Build enhanced LSTM model"""
+        from tensorflow.keras.models import Model
+        from tensorflow.keras.layers import Input, LSTM, Dense, Dropout, BatchNormalization
+        
         inputs = Input(shape=(self.TIME_STEPS, self.n_features))
         
         x = LSTM(128, return_sequences=True)(inputs)
@@ -422,16 +476,21 @@ class AlertClassifier:
         return model
 
     def _load_or_train_model(self):
-        """Load or train model"""
-        features, labels = self._load_data_for_training()
+        """Load or train model. Returns (model, scaler); slow, so run it in the background."""
+        from tensorflow.keras.models import load_model
+        from sklearn.model_selection import train_test_split
+        
+        features, labels, scaler = self._load_data_for_training()
         if features is None or labels is None:
             print("Using rule-based system only.")
-            return None
+            return None, None
 
         if os.path.exists(self.model_path):
             try:
                 print("Loading multi-class classifier...")
-                return load_model(self.model_path)
+                model = load_model(self.model_path)
+                self._model_source_mtime = os.path.getmtime(self.model_path)
+                return model, scaler
             except:
                 print("Model load failed, training new one...")
         
@@ -440,7 +499,7 @@ class AlertClassifier:
         
         if len(X) < 100:
             print("Insufficient data. Using rules only.")
-            return None
+            return None, None
         
         X_train, X_test, y_train, y_test = train_test_split(
             X, y, test_size=0.2, random_state=42, stratify=y
@@ -462,7 +521,104 @@ class AlertClassifier:
         )
         
         model.save(self.model_path)
-        return model
+        self._model_source_mtime = os.path.getmtime(self.model_path)
+        return model, scaler
+
+    def retrain_async(self):
+        """Load or retrain the Keras model on a daemon thread; rules serve meanwhile."""
+        if self._training is not None and self._training.is_alive():
+            return False
+        self._training = threading.Thread(target=self._background_train, daemon=True)
+        self._training.start()
+        return True
+
+    def _background_train(self):
+        start = time.time()
+        try:
+            model, scaler = self._load_or_train_model()
+        except Exception as e:
+            print(f"⚠️  Background model job failed: {e}")
+            return
+        if model is None:
+            return
+        
+        try:
+            model = FrozenModel.from_keras(model)
+        except ValueError as e:
+            print(f"⚠️  Model kept in Keras, not snapshot-able: {e}")
+        
+        # Scaler first: a request between the two sees the new scaler with no model
+        # (rules only) or with the old one, never a model with a stale scaler
+        self.model = None
+        self.scaler = FrozenScaler.from_sklearn(scaler)
+        self.model = model
+        self.model_version += 1
+        print(f"🧠 Classifier ready after {time.time() - start:.1f}s in background (model v{self.model_version})")
+
+    # ---------- fast-start snapshot ----------
+
+    def _snapshot_schema(self):
+        return {'time_steps': self.TIME_STEPS, 'features': self.FEATURES, 'classes': self.n_classes}
+
+    def _model_file_newer(self):
+        """True if the .h5 was replaced after the snapshot's model was taken from it."""
+        if self._model_source_mtime is None or not os.path.exists(self.model_path):
+            return False
+        return os.path.getmtime(self.model_path) > self._model_source_mtime
+
+    def save_snapshot(self, replay_state=None):
+        """
+        Write weights, scaler, baselines and the caller's replay state to the
+        snapshot file. Cheap (a few hundred KB); call it whenever state moved on.
+        """
+        if not self.snapshot_path:
+            return False
+        model, scaler = self.model, self.scaler
+        arrays = {}
+        model_meta = None
+        if isinstance(model, FrozenModel) and isinstance(scaler, FrozenScaler):
+            arrays.update(model.arrays)
+            arrays.update(scaler.arrays())
+            model_meta = {'layers': model.layers, 'source_mtime': self._model_source_mtime}
+        
+        meta = {
+            'schema': self._snapshot_schema(),
+            'model': model_meta,
+            'baselines': self.node_baselines.to_dict(),
+            'replay': replay_state
+        }
+        try:
+            snapshot.write(self.snapshot_path, meta, arrays)
+            return True
+        except Exception as e:
+            print(f"Snapshot save failed: {e}")
+            return False
+
+    def restore_snapshot(self):
+        """Serve from the snapshot file if it matches this classifier. True on success."""
+        if not self.snapshot_path or not os.path.exists(self.snapshot_path):
+            return False
+        start = time.perf_counter()
+        try:
+            meta, arrays = snapshot.read(self.snapshot_path)
+            if meta.get('schema') != self._snapshot_schema():
+                raise ValueError("model schema changed")
+            
+            model_meta = meta.get('model')
+            if model_meta:
+                self.scaler = FrozenScaler(arrays['scaler.mean'], arrays['scaler.scale'])
+                self.model = FrozenModel(model_meta['layers'], arrays)
+                self._model_source_mtime = model_meta.get('source_mtime')
+                self.model_version += 1
+            self.node_baselines.load_dict(meta.get('baselines') or {})
+            self.replay_state = meta.get('replay')
+        except Exception as e:
+            print(f"⚠️  Snapshot unusable ({e}); cold start")
+            return False
+        
+        print(f"⚡ Restored snapshot in {(time.perf_counter() - start) * 1000:.0f} ms "
+              f"({'LSTM + rules' if self.model is not None else 'rules only'})")
+        return model_meta is not None
 
     def get_health_score_and_prediction(self, node_id: str, recent_readings: list):
         """
@@ -486,8 +642,7 @@ class AlertClassifier:
         ai_class, ai_conf = rule_class, rule_conf
         if self.model is not None:
             try:
-                df = pd.DataFrame([r.__dict__ for r in sorted_readings])
-                features = df[['voltage', 'current', 'light']].rename(columns={'light': 'lightIntensity'})
+                features = np.array([[r.voltage, r.current, r.light] for r in sorted_readings], dtype=np.float32)
                 scaled = self.scaler.transform(features)
                 sequence = np.array([scaled])
                 predictions = self.model.predict(sequence, verbose=0)[0]
@@ -515,7 +670,7 @@ class AlertClassifier:
         
         # Clamp confidence
         conf_min, conf_max = alert_cfg['confidence_range']
-        final_conf = np.clip(final_conf, conf_min, conf_max)
+        final_conf = float(np.clip(final_conf, conf_min, conf_max))
         
         # Health score
         if final_class == 0:
@@ -532,6 +687,8 @@ class AlertClassifier:
             
             triggers_text = ', '.join(context.get('triggers', ['pattern_analysis']))
             scores_text = f"Anomaly scores - V:{context['scores']['voltage']:.0f} C:{context['scores']['current']:.0f} L:{context['scores']['light']:.0f}"
+            if context['scores'].get('spectral'):
+                scores_text += f" H:{context['scores']['spectral']:.0f}"
             
             explanation = f"{alert_cfg['historical']} {alert_cfg['live']} Triggers: {triggers_text}. {scores_text}"
             
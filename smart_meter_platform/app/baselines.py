@@ -0,0 +1,244 @@
+"""
+Per-node streaming sensor baselines.
+
+Each node/sensor pair keeps a Welford running mean/variance and two P²
+quantile estimators (5th and 95th percentile). Each reading updates them in
+O(1) time and constant memory. Only NORMAL readings are learned from, so a
+tamper does not drag its own node's baseline toward itself. A node with too
+little history falls back to the fleet-wide baseline, which is fed by every
+node.
+
+The whole store serialises to a small JSON file and is reloaded on start,
+so baselines survive restarts without re-reading the log.
+"""
+import json
+import math
+import os
+import time
+
+from app.history import parse_timestamp
+
+SENSORS = {'voltage': 'voltage', 'current': 'current', 'light': 'lightIntensity'}
+MIN_STD = {'voltage': 1.0, 'current': 0.5, 'light': 10.0}
+MIN_NODE_SAMPLES = 30       # below this a node uses the fleet baseline
+FLEET = '*'
+SAVE_INTERVAL = 30          # seconds between saves while readings arrive
+
+
+class P2Quantile:
+    """Jain & Chlamtac P² estimator: one quantile from five markers."""
+
+    def __init__(self, p):
+        self.p = p
+        self.q = []                                     # marker heights
+        self.n = [0, 1, 2, 3, 4]                        # marker positions
+        self.np = [0, 2 * p, 4 * p, 2 + 2 * p, 4]       # desired positions
+        self.dn = [0, p / 2, p, (1 + p) / 2, 1]
+
+    def add(self, x):
+        q, n = self.q, self.n
+        if len(q) < 5:
+            q.append(x)
+            q.sort()
+            return
+
+        if x < q[0]:
+            q[0] = x
+            k = 0
+        elif x >= q[4]:
+            q[4] = x
+            k = 3
+        else:
+            k = 0
+            while x >= q[k + 1]:
+                k += 1
+
+        for i in range(k + 1, 5):
+            n[i] += 1
+        for i in range(5):
+            self.np[i] += self.dn[i]
+
+        for i in (1, 2, 3):
+            d = self.np[i] - n[i]
+            if (d >= 1 and n[i + 1] - n[i] > 1) or (d <= -1 and n[i - 1] - n[i] < -1):
+                d = 1 if d > 0 else -1
+                qp = q[i] + d / (n[i + 1] - n[i - 1]) * (
+                    (n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / (n[i + 1] - n[i]) +
+                    (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]))
+                if not q[i - 1] < qp < q[i + 1]:
+                    qp = q[i] + d * (q[i + d] - q[i]) / (n[i + d] - n[i])
+                q[i] = qp
+                n[i] += d
+
+    def value(self):
+        if not self.q:
+            return None
+        if len(self.q) < 5:
+            # Exact nearest-rank percentile while there are too few samples
+            return self.q[min(len(self.q) - 1, int(self.p * len(self.q)))]
+        return self.q[2]
+
+    def to_dict(self):
+        return {'p': self.p, 'q': self.q, 'n': self.n, 'np': self.np}
+
+    @classmethod
+    def from_dict(cls, d):
+        est = cls(d['p'])
+        est.q, est.n, est.np = list(d['q']), list(d['n']), list(d['np'])
+        return est
+
+
+class RunningStats:
+    """Welford mean/variance plus P² 5th/95th percentiles of one signal."""
+
+    def __init__(self):
+        self.count = 0
+        self.mean = 0.0
+        self.m2 = 0.0
+        self.p05 = P2Quantile(0.05)
+        self.p95 = P2Quantile(0.95)
+
+    def add(self, x):
+        self.count += 1
+        delta = x - self.mean
+        self.mean += delta / self.count
+        self.m2 += delta * (x - self.mean)
+        self.p05.add(x)
+        self.p95.add(x)
+
+    @property
+    def std(self):
+        return math.sqrt(self.m2 / self.count) if self.count else 0.0
+
+    def to_dict(self):
+        return {'count': self.count, 'mean': self.mean, 'm2': self.m2,
+                'p05': self.p05.to_dict(), 'p95': self.p95.to_dict()}
+
+    @classmethod
+    def from_dict(cls, d):
+        rs = cls()
+        rs.count, rs.mean, rs.m2 = d['count'], d['mean'], d['m2']
+        rs.p05 = P2Quantile.from_dict(d['p05'])
+        rs.p95 = P2Quantile.from_dict(d['p95'])
+        return rs
+
+
+class BaselineStore:
+    def __init__(self, path=None, defaults=None):
+        self.path = path
+        self.defaults = defaults or {}
+        self.nodes = {}         # node_id -> {sensor: RunningStats}
+        self.last_ts = {}       # node_id -> newest reading learned (epoch s)
+        self._newest = 0.0
+        self._dirty = False
+        self._last_save = 0.0
+
+    # ---------- learning ----------
+
+    def observe(self, node_id, entry, ts=None):
+        """Fold one raw log entry into the node and fleet baselines, O(1)."""
+        ts = ts if ts is not None else parse_timestamp(entry.get('timestamp'))
+        if ts is None or not node_id or ts <= self.last_ts.get(node_id, 0):
+            return False
+        self.last_ts[node_id] = ts
+        self._newest = max(self._newest, ts)
+        if entry.get('tamperFlag') == 1:
+            return False
+
+        for key in (node_id, FLEET):
+            stats = self.nodes.setdefault(key, {s: RunningStats() for s in SENSORS})
+            for sensor, json_key in SENSORS.items():
+                value = entry.get(json_key)
+                if value is not None:
+                    stats[sensor].add(float(value))
+        self._dirty = True
+        return True
+
+    def ingest(self, entries):
+        """
+        Learn entries newer than anything seen so far. The log is appended in
+        time order, so only its tail is scanned. Returns how many were learned.
+        """
+        fresh = []
+        for entry in reversed(entries):
+            ts = parse_timestamp(entry.get('timestamp'))
+            if ts is None:
+                continue
+            if ts <= self._newest:
+                break
+            fresh.append((entry, ts))
+
+        learned = sum(self.observe(e.get('node_id'), e, ts) for e, ts in reversed(fresh))
+        if self._dirty and time.time() - self._last_save >= SAVE_INTERVAL:
+            self.save()
+        return learned
+
+    # ---------- lookup ----------
+
+    def get(self, node_id):
+        """{'voltage': {'min','max','mean','std','count'}, ...} in the shape the
+        classifier already uses; min/max are the 5th/95th percentiles."""
+        node = self.nodes.get(node_id)
+        fleet = self.nodes.get(FLEET)
+        out = {}
+        for sensor in SENSORS:
+            stats = None
+            if node and node[sensor].count >= MIN_NODE_SAMPLES:
+                stats = node[sensor]
+            elif fleet and fleet[sensor].count >= MIN_NODE_SAMPLES:
+                stats = fleet[sensor]
+
+            if stats is None:
+                out[sensor] = dict(self.defaults.get(sensor, {}), count=0)
+            else:
+                out[sensor] = {
+                    'min': stats.p05.value(),
+                    'max': stats.p95.value(),
+                    'mean': stats.mean,
+                    'std': max(stats.std, MIN_STD[sensor]),
+                    'count': stats.count
+                }
+        return out
+
+    # ---------- persistence ----------
+
+    def to_dict(self):
+        return {
+            'version': 1,
+            'nodes': {nid: {s: rs.to_dict() for s, rs in stats.items()} for nid, stats in self.nodes.items()},
+            'last_ts': self.last_ts
+        }
+
+    def load_dict(self, d):
+        self.nodes = {nid: {s: RunningStats.from_dict(rs) for s, rs in stats.items()}
+                      for nid, stats in d.get('nodes', {}).items()}
+        self.last_ts = dict(d.get('last_ts', {}))
+        self._newest = max(self.last_ts.values(), default=0.0)
+
+    def load(self):
+        if not self.path or not os.path.exists(self.path):
+            return False
+        try:
+            with open(self.path, 'r') as f:
+                d = json.load(f)
+            # Never roll back to an older state (e.g. after a snapshot restore)
+            if max(d.get('last_ts', {}).values(), default=0.0) >= self._newest:
+                self.load_dict(d)
+            return True
+        except Exception as e:
+            print(f"Baseline file unreadable ({e}); relearning from the log")
+            return False
+
+    def save(self):
+        """Atomic write: a crash mid-save leaves the previous file intact."""
+        if not self.path:
+            return
+        tmp = self.path + '.tmp'
+        try:
+            with open(tmp, 'w') as f:
+                json.dump(self.to_dict(), f)
+            os.replace(tmp, self.path)
+            self._dirty = False
+            self._last_save = time.time()
+        except Exception as e:
+            print(f"Baseline save failed: {e}")
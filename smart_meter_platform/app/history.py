@@ -0,0 +1,223 @@
+"""
+Time-indexed reading history for chart queries and exports.
+
+Readings are kept per node in columnar arrays sorted by timestamp, so a
+time range is two binary searches and a slice. Charts get server-side
+downsampling (LTTB or min/max buckets) to a requested point count; exports
+are generated in fixed-size chunks so memory stays bounded regardless of
+the range requested.
+"""
+import json
+import threading
+from array import array
+from bisect import bisect_left, bisect_right
+from datetime import datetime
+
+import numpy as np
+
+FIELDS = ('voltage', 'current', 'light')
+JSON_KEYS = {'voltage': 'voltage', 'current': 'current', 'light': 'lightIntensity'}
+MAX_POINTS = 5000
+LTTB_PRESELECT = 4      # min/max thinning factor before LTTB on long ranges
+EXPORT_CHUNK = 1000
+
+
+def parse_timestamp(ts):
+    """ISO-8601 string (with or without 'Z') to epoch seconds; None if malformed."""
+    try:
+        return datetime.fromisoformat(ts.replace('Z', '+00:00')).timestamp()
+    except (AttributeError, ValueError):
+        return None
+
+
+class NodeSeries:
+    """Columnar, timestamp-sorted readings of one node."""
+
+    def __init__(self):
+        self.t = array('d')
+        self.tamper = array('b')
+        self.cols = {f: array('d') for f in FIELDS}
+
+    def __len__(self):
+        return len(self.t)
+
+    def append(self, t, entry):
+        values = [float(entry.get(JSON_KEYS[f], 0) or 0) for f in FIELDS]
+        tamper = 1 if entry.get('tamperFlag') == 1 else 0
+
+        # The collector appends in order; an older reading is spliced in place
+        i = len(self.t)
+        if i and t < self.t[-1]:
+            i = bisect_right(self.t, t)
+        self.t.insert(i, t)
+        self.tamper.insert(i, tamper)
+        for f, v in zip(FIELDS, values):
+            self.cols[f].insert(i, v)
+
+    def range(self, start, end):
+        """Index range [lo, hi) of readings with start <= t <= end."""
+        lo = 0 if start is None else bisect_left(self.t, start)
+        hi = len(self.t) if end is None else bisect_right(self.t, end)
+        return lo, max(lo, hi)
+
+
+class HistoryIndex:
+    """Per-node time index over the sensor log, fed incrementally."""
+
+    def __init__(self):
+        self._lock = threading.Lock()
+        self._nodes = {}
+
+    def reset(self):
+        """Forget everything; the log is about to be read from the start."""
+        with self._lock:
+            self._nodes = {}
+
+    def ingest(self, entries):
+        """Index entries newly appended to the log."""
+        with self._lock:
+            for entry in entries:
+                t = parse_timestamp(entry.get('timestamp'))
+                nid = entry.get('node_id')
+                if t is None or not nid:
+                    continue
+                self._nodes.setdefault(nid, NodeSeries()).append(t, entry)
+
+    def nodes(self):
+        with self._lock:
+            return sorted(self._nodes)
+
+    def query(self, node_id, start=None, end=None, points=500, fields=FIELDS, mode='lttb'):
+        """
+        Downsampled series for one node over [start, end] (epoch seconds).
+        Returns None for an unknown node.
+        """
+        points = max(3, min(int(points), MAX_POINTS))
+        with self._lock:
+            series = self._nodes.get(node_id)
+            if series is None:
+                return None
+            lo, hi = series.range(start, end)
+            result = {'node_id': node_id, 'total': hi - lo, 'mode': mode,
+                      'series': _downsample(series, lo, hi, points, fields, mode)}
+        return result
+
+    def export_rows(self, node_id, start=None, end=None):
+        """
+        Yield lists of (iso_time, node_id, voltage, current, light, tamper)
+        rows, EXPORT_CHUNK at a time, copying only one chunk under the lock.
+        """
+        nodes = [node_id] if node_id else self.nodes()
+        for nid in nodes:
+            with self._lock:
+                series = self._nodes.get(nid)
+                if series is None:
+                    continue
+                lo, hi = series.range(start, end)
+            pos = lo
+            while pos < hi:
+                with self._lock:
+                    stop = min(pos + EXPORT_CHUNK, hi, len(series))
+                    t = series.t[pos:stop]
+                    cols = [series.cols[f][pos:stop] for f in FIELDS]
+                    tamper = series.tamper[pos:stop]
+                if not t:
+                    break
+                yield [(_iso(t[k]), nid, *(c[k] for c in cols), tamper[k]) for k in range(len(t))]
+                pos = stop
+
+
+def _downsample(series, lo, hi, points, fields, mode):
+    # Zero-copy views of the arrays; they die with this frame, before the
+    # caller releases the lock (ingest() cannot resize an exported buffer)
+    t = np.frombuffer(series.t, dtype=np.float64)[lo:hi]
+    out = {}
+    for f in fields:
+        y = np.frombuffer(series.cols[f], dtype=np.float64)[lo:hi]
+        idx = minmax_indices(y, points) if mode == 'minmax' else lttb_indices(t, y, points)
+        out[f] = {'t': [_iso(x) for x in t[idx]], 'v': y[idx].tolist()}
+    return out
+
+
+def _iso(t):
+    return datetime.fromtimestamp(float(t)).isoformat()
+
+
+def lttb_indices(t, y, threshold):
+    """
+    Largest-Triangle-Three-Buckets: keeps first and last points and, for
+    each bucket in between, the point forming the largest triangle with the
+    previously kept point and the average of the next bucket. Long ranges
+    are first thinned to per-bucket min/max (MinMaxLTTB), which keeps the
+    peaks LTTB would pick while bounding the work per query.
+    """
+    n = len(y)
+    if n <= threshold:
+        return np.arange(n)
+    if n > LTTB_PRESELECT * threshold:
+        pre = minmax_indices(y, LTTB_PRESELECT * threshold)
+        return pre[_lttb(t[pre], y[pre], threshold)]
+    return _lttb(t, y, threshold)
+
+
+def _lttb(t, y, threshold):
+    n = len(y)
+    if n <= threshold:
+        return np.arange(n)
+
+    # Bucket i spans [edges[i], edges[i+1]); the last point is its own bucket
+    edges = np.append(np.linspace(1, n - 1, threshold - 1).astype(np.int64), n)
+    counts = np.diff(edges)
+    avg_t = np.add.reduceat(t, edges[:-1]) / counts
+    avg_y = np.add.reduceat(y, edges[:-1]) / counts
+
+    idx = np.empty(threshold, dtype=np.int64)
+    idx[0], idx[-1] = 0, n - 1
+
+    a = 0
+    for i in range(threshold - 2):
+        b0, b1 = edges[i], edges[i + 1]
+        ta, ya = t[a], y[a]
+        area = np.abs((ta - avg_t[i + 1]) * (y[b0:b1] - ya) - (ta - t[b0:b1]) * (avg_y[i + 1] - ya))
+        a = b0 + int(area.argmax())
+        idx[i + 1] = a
+    return idx
+
+
+def minmax_indices(y, threshold):
+    """
+    First, last, and the min and max of (threshold - 2) / 2 buckets between
+    them, in time order; never more than threshold points.
+    """
+    n = len(y)
+    if n <= threshold:
+        return np.arange(n)
+
+    buckets = (threshold - 2) // 2
+    if buckets < 1:
+        return np.array([0, n - 1], dtype=np.int64)
+    # Equal buckets over y[1:n-1]; the last one also takes the remainder
+    size = (n - 2) // buckets
+    whole = 1 + size * (buckets - 1)
+    blocks = y[1:whole].reshape(buckets - 1, size)
+    base = 1 + np.arange(buckets - 1, dtype=np.int64) * size
+    tail = y[whole:n - 1]
+    parts = [base + blocks.argmin(axis=1), base + blocks.argmax(axis=1), [0, n - 1],
+             [whole + int(tail.argmin()), whole + int(tail.argmax())]]
+    return np.unique(np.concatenate(parts).astype(np.int64))
+
+
+def rows_to_csv(rows, header=False):
+    lines = ['timestamp,node_id,voltage,current,lightIntensity,tamperFlag\n'] if header else []
+    lines.extend(f"{ts},{nid},{v:g},{c:g},{l:g},{tf}\n" for ts, nid, v, c, l, tf in rows)
+    return ''.join(lines)
+
+
+def rows_to_ndjson(rows):
+    return ''.join(json.dumps({
+        'timestamp': ts, 'node_id': nid, 'voltage': v, 'current': c,
+        'lightIntensity': l, 'tamperFlag': tf
+    }) + '\n' for ts, nid, v, c, l, tf in rows)
+
+
+history = HistoryIndex()
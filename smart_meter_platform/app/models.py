@@ -59,6 +59,9 @@ class MeterReading:
     hmac: str = ""
     verified: bool = True
     health_score: int = 100
+    thd: Optional[float] = None               # current THD, % of fundamental
+    harmonics: Optional[List[int]] = None     # h1..h8 peak amplitude, ADC counts
+    harmonics_measured: bool = False          # from a sampled CT window, not simulated
 
 @dataclass
 class AIPrediction:
@@ -68,3 +71,5 @@ class AIPrediction:
     confidence: float
     explanation: str
     severity: Severity
+    capture_id: Optional[str] = None  # waveform captured around the triggering tamper
+    trace: Optional[dict] = None      # seq, device time and host stage times of the source reading
@@ -1,7 +1,8 @@
-from flask import Blueprint, jsonify, render_template, request
-from . import db, initialize_data
-from app.pid_controller import simulation
-from app.utils import convert_json_to_meter_reading
+from datetime import datetime, timedelta
+from flask import Blueprint, Response, jsonify, render_template, request
+from app.state import store
+from app.utils import convert_json_to_meter_reading, load_capture, load_ingest_stats
+from app.history import FIELDS, history, parse_timestamp, rows_to_csv, rows_to_ndjson
 
 # Import analytics (create this file in your app/)
 try:
@@ -20,7 +21,7 @@ def index():
 
 @bp.route('/api/status', methods=['GET'])
 def get_status():
-    readings = list(db["meter_readings"].values())
+    readings = list(store.current().meter_readings.values())
     if not readings:
         return jsonify({
             "total_nodes": 0, "tampered_nodes": 0, "avg_confidence": 0, "verified_ratio": 0,
@@ -38,29 +39,107 @@ def get_status():
 
 @bp.route('/api/readings', methods=['GET'])
 def get_readings():
-    readings_list = [reading.__dict__ for reading in db["meter_readings"].values()]
+    readings_list = [reading.__dict__ for reading in store.current().meter_readings.values()]
     readings_list.sort(key=lambda x: x['node_id'])
     return jsonify(readings_list)
 
 @bp.route('/api/logs', methods=['GET'])
 def get_logs():
-    raw_data = db["json_data"]
-    recent = raw_data[-200:][::-1]
+    recent = store.current().json_tail[::-1]
     formatted = [convert_json_to_meter_reading(x).__dict__ for x in recent]
     return jsonify(formatted)
 
 @bp.route('/api/predictions', methods=['GET'])
 def get_predictions():
-    predictions_list = [pred.__dict__ for pred in db["predictions"]]
+    predictions_list = [pred.__dict__ for pred in store.current().predictions]
     return jsonify(predictions_list)
 
+@bp.route('/api/captures/<capture_id>', methods=['GET'])
+def get_capture(capture_id):
+    capture = load_capture(capture_id)
+    if capture is None:
+        return jsonify({"error": "Capture not found"}), 404
+    return jsonify(capture)
+
+def _time_range_args():
+    """(start, end) epoch seconds from ?days= or ?start=&end= (ISO); raises ValueError."""
+    start = end = None
+    if request.args.get('start'):
+        start = parse_timestamp(request.args['start'])
+        if start is None:
+            raise ValueError("bad start")
+    if request.args.get('end'):
+        end = parse_timestamp(request.args['end'])
+        if end is None:
+            raise ValueError("bad end")
+    if start is None and 'days' in request.args:
+        days = request.args.get('days', type=float)
+        if days is None or days <= 0:
+            raise ValueError("bad days")
+        start = (datetime.now() - timedelta(days=days)).timestamp()
+    return start, end
+
+@bp.route('/api/history', methods=['GET'])
+def get_history():
+    """
+    Downsampled time series for one node
+    GET /api/history?node=NODE-03&days=7&points=500&mode=lttb|minmax&fields=voltage,current
+    (start=/end= ISO timestamps may replace days)
+    """
+    node_id = request.args.get('node')
+    if not node_id:
+        return jsonify({"error": "node is required", "nodes": history.nodes()}), 400
+    try:
+        start, end = _time_range_args()
+    except ValueError as e:
+        return jsonify({"error": str(e)}), 400
+
+    fields = [f for f in request.args.get('fields', ','.join(FIELDS)).split(',') if f in FIELDS]
+    mode = request.args.get('mode', 'lttb')
+    if mode not in ('lttb', 'minmax') or not fields:
+        return jsonify({"error": "bad mode or fields"}), 400
+
+    result = history.query(node_id, start, end, request.args.get('points', 500, type=int), fields, mode)
+    if result is None:
+        return jsonify({"error": "Unknown node"}), 404
+    return jsonify(result)
+
+@bp.route('/api/export/history', methods=['GET'])
+def export_history():
+    """
+    Stream raw readings, one chunk at a time
+    GET /api/export/history?node=NODE-03&days=30&format=csv|ndjson (all nodes if node is omitted)
+    """
+    node_id = request.args.get('node')
+    fmt = request.args.get('format', 'csv')
+    if fmt not in ('csv', 'ndjson'):
+        return jsonify({"error": "format must be csv or ndjson"}), 400
+    try:
+        start, end = _time_range_args()
+    except ValueError as e:
+        return jsonify({"error": str(e)}), 400
+
+    def generate():
+        if fmt == 'csv':
+            yield rows_to_csv([], header=True)
+        for rows in history.export_rows(node_id, start, end):
+            yield rows_to_csv(rows) if fmt == 'csv' else rows_to_ndjson(rows)
+
+    name = f"history_{node_id or 'all'}.{fmt}"
+    return Response(
+        generate(),
+        mimetype='text/csv' if fmt == 'csv' else 'application/x-ndjson',
+        headers={'Content-Disposition': f'attachment; filename={name}'}
+    )
+
 @bp.route('/api/pid_data', methods=['GET'])
 def get_pid_data():
-    return jsonify(simulation.get_history())
+    return jsonify(store.current().pid_history)
 
 @bp.route('/api/simulate', methods=['POST'])
 def simulate_new_data():
-    initialize_data()
+    # Picked up by the single writer within a second, whichever worker got this
+    store.request_reinit()
     return jsonify({"message": "OK"}), 200
 
 
@@ -77,7 +156,7 @@ def get_executive_summary():
     if not ANALYTICS_ENABLED:
         return jsonify({"error": "Analytics not enabled"}), 501
     
-    summary = generate_executive_summary(db)
+    summary = generate_executive_summary(store.current())
     return jsonify(summary)
 
 
@@ -90,7 +169,7 @@ def get_alert_distribution():
     if not ANALYTICS_ENABLED:
         return jsonify({"error": "Analytics not enabled"}), 501
     
-    engine = AnalyticsEngine(db)
+    engine = AnalyticsEngine(store.current())
     analysis = engine.get_alert_distribution_analysis()
     return jsonify(analysis)
 
@@ -104,7 +183,7 @@ def get_node_health_analysis():
     if not ANALYTICS_ENABLED:
         return jsonify({"error": "Analytics not enabled"}), 501
     
-    engine = AnalyticsEngine(db)
+    engine = AnalyticsEngine(store.current())
     analysis = engine.get_node_health_trends()
     return jsonify(analysis)
 
@@ -118,7 +197,7 @@ def get_temporal_patterns():
     if not ANALYTICS_ENABLED:
         return jsonify({"error": "Analytics not enabled"}), 501
     
-    engine = AnalyticsEngine(db)
+    engine = AnalyticsEngine(store.current())
     patterns = engine.get_temporal_patterns()
     return jsonify(patterns)
 
@@ -132,7 +211,7 @@ def get_config_recommendations():
     if not ANALYTICS_ENABLED:
         return jsonify({"error": "Analytics not enabled"}), 501
     
-    engine = AnalyticsEngine(db)
+    engine = AnalyticsEngine(store.current())
     recommendations = engine.get_configuration_recommendations()
     return jsonify(recommendations)
 
@@ -143,18 +222,25 @@ def get_system_stats():
     Comprehensive system statistics
     GET /api/analytics/stats
     """
+    snap = store.current()
     stats = {
         'data': {
-            'total_records': len(db.get('json_data', [])),
-            'total_nodes': len(db.get('meter_readings', {})),
-            'total_predictions': len(db.get('predictions', [])),
-            'last_processed_index': db.get('last_processed_index', 0)
+            'total_records': snap.total_records,
+            'total_nodes': len(snap.meter_readings),
+            'total_predictions': len(snap.predictions),
+            'last_processed_index': snap.last_processed_index
         },
-        'alert_stats': db.get('alert_stats', {})
+        'alert_stats': snap.alert_stats,
+        'state': {
+            'version': snap.version,
+            'published_at': snap.published_at,
+            'role': 'writer' if store.is_writer else 'reader',
+            **store.stats
+        }
     }
     
     # Add alert type breakdown
-    predictions = db.get('predictions', [])
+    predictions = snap.predictions
     if predictions:
         from collections import Counter
         type_counts = Counter(p.event_type for p in predictions)
@@ -175,49 +261,70 @@ def get_system_stats():
     return jsonify(stats)
 
 
+@bp.route('/api/metrics/latency', methods=['GET'])
+def get_latency_metrics():
+    """
+    Per-stage latency histograms (sample -> receive -> persist -> load ->
+    classify -> publish) and per-device sequence gap counters
+    GET /api/metrics/latency
+    """
+    snap = store.current()
+    return jsonify(dict(snap.latency, state_version=snap.version, published_at=snap.published_at))
+
+
+@bp.route('/api/metrics/ingest', methods=['GET'])
+def get_ingest_metrics():
+    """
+    Frame verification counters and throughput from the serial collector,
+    with per-port line rates and error counters under 'ports'
+    GET /api/metrics/ingest
+    """
+    stats = load_ingest_stats()
+    if stats is None:
+        return jsonify({"error": "Collector has not reported yet"}), 404
+    return jsonify(stats)
+
+
 @bp.route('/api/export/alerts', methods=['GET'])
 def export_alerts_csv():
     """
     Export alerts as CSV
     GET /api/export/alerts?format=csv&days=7
     """
-    from datetime import datetime, timedelta
     import io
     import csv
     
     days = request.args.get('days', 7, type=int)
-    cutoff = datetime.now() - timedelta(days=days)
-    
-    predictions = db.get('predictions', [])
+    cutoff = (datetime.now() - timedelta(days=days)).timestamp()
     
-    # Filter by date
-    filtered = []
-    for pred in predictions:
-        try:
-            ts = datetime.fromisoformat(pred.timestamp.replace('Z', '+00:00'))
-            if ts >= cutoff:
-                filtered.append(pred)
-        except:
-            continue
+    # The snapshot stays valid for the whole stream
+    predictions = store.current().predictions
     
-    # Create CSV
-    output = io.StringIO()
-    writer = csv.writer(output)
-    writer.writerow(['Timestamp', 'Node ID', 'Event Type', 'Confidence', 'Severity', 'Explanation'])
-    
-    for pred in filtered:
-        writer.writerow([
-            pred.timestamp,
-            pred.node_id,
-            pred.event_type,
-            f"{pred.confidence:.1f}%",
-            pred.severity,
-            pred.explanation
-        ])
+    def generate():
+        output = io.StringIO()
+        writer = csv.writer(output)
+        writer.writerow(['Timestamp', 'Node ID', 'Event Type', 'Confidence', 'Severity', 'Explanation'])
+        
+        for i, pred in enumerate(predictions):
+            ts = parse_timestamp(pred.timestamp)
+            if ts is None or ts < cutoff:
+                continue
+            writer.writerow([
+                pred.timestamp,
+                pred.node_id,
+                pred.event_type,
+                f"{pred.confidence:.1f}%",
+                pred.severity,
+                pred.explanation
+            ])
+            if i % 100 == 99:
+                yield output.getvalue()
+                output.seek(0)
+                output.truncate()
+        yield output.getvalue()
     
-    from flask import Response
     return Response(
-        output.getvalue(),
+        generate(),
         mimetype='text/csv',
         headers={'Content-Disposition': f'attachment; filename=alerts_{days}days.csv'}
     )
@@ -229,20 +336,19 @@ def health_check():
     System health check endpoint
     GET /api/health-check
     """
-    from datetime import datetime
-    
+    snap = store.current()
     health = {
         'status': 'healthy',
         'timestamp': datetime.now().isoformat(),
         'components': {
-            'database': 'ok' if db.get('json_data') else 'no_data',
+            'database': 'ok' if snap.total_records else 'no_data',
             'ai_model': 'ok',  # Could check if model is loaded
             'pid_simulation': 'ok',
             'analytics': 'ok' if ANALYTICS_ENABLED else 'disabled'
         },
         'metrics': {
-            'total_nodes': len(db.get('meter_readings', {})),
-            'active_alerts': len([p for p in db.get('predictions', []) if p.severity == 'high']),
+            'total_nodes': len(snap.meter_readings),
+            'active_alerts': len([p for p in snap.predictions if p.severity == 'high']),
             'system_uptime': 'available',  # Could track actual uptime
         }
     }
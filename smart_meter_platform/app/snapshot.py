@@ -0,0 +1,216 @@
+"""
+Fast-start model snapshot.
+
+One file holds everything the classifier needs to serve right away:
+- the LSTM weights,
+- the fitted scaler,
+- the per-node baselines,
+- the replay state (the last window of readings per node plus the alerts
+  already derived from the log).
+
+Layout:
+    header    magic 'SMSN', format version, metadata length
+    metadata  UTF-8 JSON: schema, layer list, array table, baselines, replay
+    arrays    little-endian float32, each at a 64-byte aligned offset
+
+The array section is memory-mapped on load, so weights are used in place
+without being parsed or copied. Inference runs on numpy (FrozenModel), so
+restoring needs neither TensorFlow nor scikit-learn. Those load only when
+a background job retrains.
+"""
+import json
+import mmap
+import os
+import struct
+import time
+
+import numpy as np
+
+MAGIC = b'SMSN'
+FORMAT_VERSION = 1
+HEADER = struct.Struct('<4sHHQ')    # magic, format version, reserved, metadata length
+ALIGN = 64
+
+
+# ---------- numpy inference ----------
+
+def _sigmoid(x):
+    return 1.0 / (1.0 + np.exp(-x))
+
+
+def _softmax(x):
+    e = np.exp(x - x.max(axis=-1, keepdims=True))
+    return e / e.sum(axis=-1, keepdims=True)
+
+
+ACTIVATIONS = {
+    'linear': lambda x: x,
+    'relu': lambda x: np.maximum(x, 0),
+    'tanh': np.tanh,
+    'sigmoid': _sigmoid,
+    'softmax': _softmax,
+}
+
+
+class FrozenScaler:
+    """StandardScaler.transform() from stored mean/scale."""
+
+    def __init__(self, mean, scale):
+        self.mean = np.asarray(mean, dtype=np.float32)
+        self.scale = np.asarray(scale, dtype=np.float32)
+
+    @classmethod
+    def from_sklearn(cls, scaler):
+        return cls(scaler.mean_, scaler.scale_)
+
+    def transform(self, x):
+        return (np.asarray(x, dtype=np.float32) - self.mean) / self.scale
+
+    def arrays(self):
+        return {'scaler.mean': self.mean, 'scaler.scale': self.scale}
+
+
+class FrozenModel:
+    """
+    Inference-only copy of the Keras classifier: LSTM, BatchNormalization,
+    Dense and Dropout layers evaluated with numpy. It exposes the same
+    predict(x, verbose=0) call the classifier already makes.
+    """
+
+    def __init__(self, layers, arrays):
+        self.layers = layers        # [{'type', 'name', ...config}], JSON-able
+        self.arrays = arrays        # 'layer/weight' -> ndarray
+
+    @classmethod
+    def from_keras(cls, model):
+        """Copy weights out of a built Keras model; ValueError if a layer is unsupported."""
+        layers, arrays = [], {}
+        for layer in model.layers:
+            kind = type(layer).__name__
+            cfg = layer.get_config()
+            spec = {'type': kind, 'name': layer.name}
+            weights = [np.asarray(w, dtype=np.float32) for w in layer.get_weights()]
+
+            if kind in ('InputLayer', 'Dropout'):
+                continue
+            if kind == 'LSTM':
+                if cfg.get('activation') != 'tanh' or cfg.get('recurrent_activation') != 'sigmoid':
+                    raise ValueError(f"{layer.name}: only tanh/sigmoid LSTMs are supported")
+                if cfg.get('go_backwards') or not cfg.get('use_bias', True):
+                    raise ValueError(f"{layer.name}: unsupported LSTM configuration")
+                spec['return_sequences'] = bool(cfg.get('return_sequences'))
+                names = ('kernel', 'recurrent_kernel', 'bias')
+            elif kind == 'BatchNormalization':
+                if not (cfg.get('center', True) and cfg.get('scale', True)):
+                    raise ValueError(f"{layer.name}: BatchNormalization without center/scale")
+                spec['epsilon'] = float(cfg.get('epsilon', 1e-3))
+                names = ('gamma', 'beta', 'moving_mean', 'moving_variance')
+            elif kind == 'Dense':
+                if cfg.get('activation') not in ACTIVATIONS or not cfg.get('use_bias', True):
+                    raise ValueError(f"{layer.name}: unsupported Dense configuration")
+                spec['activation'] = cfg['activation']
+                names = ('kernel', 'bias')
+            else:
+                raise ValueError(f"{layer.name}: layer type {kind} is not supported")
+
+            for name, w in zip(names, weights):
+                arrays[f"{layer.name}/{name}"] = w
+            layers.append(spec)
+        return cls(layers, arrays)
+
+    def predict(self, x, verbose=0):
+        x = np.asarray(x, dtype=np.float32)
+        for spec in self.layers:
+            w = lambda name: self.arrays[f"{spec['name']}/{name}"]
+            kind = spec['type']
+            if kind == 'LSTM':
+                x = _lstm(x, w('kernel'), w('recurrent_kernel'), w('bias'), spec['return_sequences'])
+            elif kind == 'BatchNormalization':
+                x = (x - w('moving_mean')) / np.sqrt(w('moving_variance') + spec['epsilon']) * w('gamma') + w('beta')
+            elif kind == 'Dense':
+                x = ACTIVATIONS[spec['activation']](x @ w('kernel') + w('bias'))
+        return x
+
+
+def _lstm(x, kernel, recurrent, bias, return_sequences):
+    """Keras LSTM forward pass; gate order i, f, c, o."""
+    batch, steps, _ = x.shape
+    units = recurrent.shape[0]
+    h = np.zeros((batch, units), dtype=np.float32)
+    c = np.zeros((batch, units), dtype=np.float32)
+    xz = x @ kernel + bias                  # input projection for every step at once
+    out = []
+    for t in range(steps):
+        z = xz[:, t] + h @ recurrent
+        i = _sigmoid(z[:, :units])
+        f = _sigmoid(z[:, units:2 * units])
+        g = np.tanh(z[:, 2 * units:3 * units])
+        o = _sigmoid(z[:, 3 * units:])
+        c = f * c + i * g
+        h = o * np.tanh(c)
+        if return_sequences:
+            out.append(h)
+    return np.stack(out, axis=1) if return_sequences else h
+
+
+# ---------- file format ----------
+
+def write(path, meta, arrays):
+    """Atomically write metadata plus float32 arrays. Returns bytes written."""
+    table, offset = {}, 0
+    blobs = []
+    for name, arr in arrays.items():
+        arr = np.ascontiguousarray(arr, dtype='<f4')
+        offset = -(-offset // ALIGN) * ALIGN
+        table[name] = {'offset': offset, 'shape': list(arr.shape)}
+        blobs.append((offset, arr))
+        offset += arr.nbytes
+
+    meta = dict(meta, arrays=table, written_at=time.time())
+    meta_bytes = json.dumps(meta, separators=(',', ':')).encode('utf-8')
+    data_start = -(-(HEADER.size + len(meta_bytes)) // ALIGN) * ALIGN
+
+    tmp = path + '.tmp'
+    with open(tmp, 'wb') as f:
+        f.write(HEADER.pack(MAGIC, FORMAT_VERSION, 0, len(meta_bytes)))
+        f.write(meta_bytes)
+        for off, arr in blobs:
+            f.seek(data_start + off)
+            f.write(arr.tobytes())
+        size = f.tell()
+    os.replace(tmp, path)
+    return size
+
+
+def read(path):
+    """
+    (metadata, arrays) from a snapshot file, or raise ValueError if it is not
+    one this code can read. Arrays are read-only views of a memory map.
+    """
+    with open(path, 'rb') as f:
+        head = f.read(HEADER.size)
+        if len(head) < HEADER.size:
+            raise ValueError("truncated header")
+        magic, version, _, meta_len = HEADER.unpack(head)
+        if magic != MAGIC:
+            raise ValueError("not a model snapshot")
+        if version != FORMAT_VERSION:
+            raise ValueError(f"format v{version}, expected v{FORMAT_VERSION}")
+        meta = json.loads(f.read(meta_len).decode('utf-8'))
+        data_start = -(-(HEADER.size + meta_len) // ALIGN) * ALIGN
+
+        if os.name == 'nt':
+            # A live mapping would block os.replace() of the next snapshot on Windows
+            f.seek(0)
+            buf = f.read()
+        else:
+            buf = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+    arrays = {}
+    for name, entry in meta['arrays'].items():
+        count = int(np.prod(entry['shape'], dtype=np.int64))
+        start = data_start + entry['offset']
+        if start + 4 * count > len(buf):
+            raise ValueError(f"array {name} runs past end of file")
+        arrays[name] = np.frombuffer(buf, dtype='<f4', count=count, offset=start).reshape(entry['shape'])
+    return meta, arrays
@@ -0,0 +1,309 @@
+"""
+Versioned, immutable application state (RCU-style).
+
+The background updater builds a complete new Snapshot and publishes it with
+one reference swap. Request handlers call store.current() once per request
+and read that snapshot without taking any lock. Snapshots are never mutated
+after publish, so every reader sees a consistent view.
+
+With several worker processes (gunicorn -w N), the first process to create
+the shared-memory segment becomes the writer and runs the updater. The
+others attach as readers. The writer serialises each snapshot into the
+inactive half of a double buffer guarded by a sequence counter (seqlock).
+Readers copy it out, check that the counter did not move, and cache the
+decoded snapshot until the next version appears.
+
+Creating, initialising and taking over the segment happen under a lock
+file, so two workers starting together cannot both become writers. Readers
+check the writer's pid about once a second. If the writer has died, the
+first reader to notice takes over the segment and becomes the writer.
+"""
+import atexit
+import os
+import pickle
+import struct
+import tempfile
+import threading
+import time
+from contextlib import contextmanager
+from dataclasses import dataclass, field, replace
+from multiprocessing import shared_memory
+
+try:
+    import fcntl
+except ImportError:     # Windows: segments vanish with their last handle, nothing to race on
+    fcntl = None
+
+SHM_NAME = os.environ.get('SMART_METER_SHM', 'smart_meter_state')   # '' disables sharing
+SHM_SIZE = int(os.environ.get('SMART_METER_SHM_SIZE', 8 * 1024 * 1024))
+LOCK_PATH = os.path.join(tempfile.gettempdir(), f"{SHM_NAME or 'smart_meter_state'}.lock")
+LOG_TAIL = 200          # raw entries kept for /api/logs
+WRITER_CHECK_INTERVAL = 1.0     # seconds between reader checks that the writer is alive
+
+MAGIC = 0x534D5354      # 'SMST'
+HEADER = struct.Struct('<IIII')      # magic, active slot, reinit requests, writer pid
+SLOT_HEADER = struct.Struct('<QQ')   # sequence (odd while writing), payload length
+
+
+@dataclass(frozen=True)
+class Snapshot:
+    """One published version of everything the API serves. Treat as read-only."""
+    version: int = 0
+    meter_readings: dict = field(default_factory=dict)
+    predictions: tuple = ()
+    alert_stats: dict = field(default_factory=lambda: {'total_processed': 0, 'by_type': {}, 'by_node': {}})
+    json_tail: tuple = ()
+    total_records: int = 0
+    last_processed_index: int = 0
+    pid_history: dict = field(default_factory=dict)
+    latency: dict = field(default_factory=dict)     # tracer.summary() at publish
+    published_at: float = 0.0
+
+    # Dict-style access keeps consumers written against the old db dict working
+    def __getitem__(self, key):
+        return getattr(self, key)
+
+    def get(self, key, default=None):
+        return getattr(self, key, default)
+
+
+def _open(create=False):
+    """Open or create the segment without registering it with this
+    process's resource tracker, which would unlink it on exit. The store
+    decides when the segment goes away (see _release)."""
+    kwargs = dict(name=SHM_NAME, create=create, size=SHM_SIZE if create else 0)
+    try:
+        return shared_memory.SharedMemory(**kwargs, track=False)
+    except TypeError:   # Python < 3.13 has no track=; unregister just this segment
+        shm = shared_memory.SharedMemory(**kwargs)
+        if os.name == 'posix':
+            from multiprocessing import resource_tracker
+            resource_tracker.unregister(shm._name, 'shared_memory')
+        return shm
+
+
+@contextmanager
+def _segment_lock():
+    """Serialises segment create/init/takeover across processes."""
+    if fcntl is None:
+        yield
+        return
+    with open(LOCK_PATH, 'a') as f:
+        fcntl.flock(f, fcntl.LOCK_EX)
+        try:
+            yield
+        finally:
+            fcntl.flock(f, fcntl.LOCK_UN)
+
+
+def _pid_alive(pid):
+    if os.name != 'posix':
+        return True     # Windows frees segments with their last handle; no stale ones
+    try:
+        os.kill(pid, 0)
+    except ProcessLookupError:
+        return False
+    except PermissionError:
+        pass
+    return True
+
+
+class StateStore:
+    def __init__(self):
+        self._snapshot = Snapshot()
+        self._write_lock = threading.Lock()
+        self._shm = None
+        self._slot_size = 0
+        self._cache_key = None
+        self._reinit_seen = 0
+        self._reinit_local = 0
+        self._claim_lock = threading.Lock()
+        self._writer_checked = 0.0
+        self._release_registered = False
+        self.is_writer = True
+        self.on_promote = None      # called once if this reader takes over as writer
+        self.stats = {'publishes': 0, 'shm_bytes': 0, 'shm_skipped': 0, 'reader_refreshes': 0, 'torn_retries': 0}
+
+    # ---------- setup ----------
+
+    def attach(self):
+        """Create the shared segment (become writer) or join an existing one (reader)."""
+        if not SHM_NAME:
+            return self
+        try:
+            self._claim()
+        except Exception as e:
+            print(f"⚠️  Shared state disabled ({e}); serving from this process only")
+            self._shm = None
+            self.is_writer = True
+        return self
+
+    def _claim(self):
+        """Join the segment of a live writer, or become the writer."""
+        with _segment_lock():
+            try:
+                shm = _open(create=True)
+                created = True
+            except FileExistsError:
+                shm = _open()
+                created = False
+
+            magic, _, _, pid = HEADER.unpack_from(shm.buf, 0)
+            if not created and magic == MAGIC and pid != os.getpid() and _pid_alive(pid):
+                role = 'reader'
+            elif not created and magic == MAGIC:
+                role = 'writer (took over from dead pid %d)' % pid
+            else:
+                # New, or its creator died before initialising it (both happen
+                # under this lock, so nobody else can be using it yet)
+                role = 'writer'
+                self._init_segment(shm)
+
+            if self._shm is not None and self._shm is not shm:
+                self._shm.close()
+            self._shm = shm
+            self._slot_size = (shm.size - HEADER.size) // 2
+            self._cache_key = None
+            if role == 'reader':
+                self.is_writer = False
+            else:
+                if not created:
+                    # Continue from the last version readers have seen
+                    self._refresh_from_shm()
+                struct.pack_into('<I', shm.buf, 12, os.getpid())
+                self.is_writer = True
+                if not self._release_registered:
+                    atexit.register(self._release)
+                    self._release_registered = True
+
+        print(f"STATE: {role} on shared segment '{SHM_NAME}' ({shm.size // 1024} KiB, pid {os.getpid()})")
+
+    def _init_segment(self, shm):
+        buf = shm.buf
+        half = (shm.size - HEADER.size) // 2
+        for slot in range(2):
+            SLOT_HEADER.pack_into(buf, HEADER.size + slot * half, 0, 0)
+        HEADER.pack_into(buf, 0, MAGIC, 0, 0, os.getpid())
+
+    def _release(self):
+        if self._shm is not None and self.is_writer:
+            try:
+                with _segment_lock():
+                    # Only unlink the segment if it is still ours
+                    if struct.unpack_from('<I', self._shm.buf, 12)[0] == os.getpid():
+                        self._shm.unlink()
+                self._shm.close()
+            except Exception:
+                pass
+            self._shm = None
+
+    # ---------- readers ----------
+
+    def current(self):
+        """The latest snapshot. Never blocks; hold on to it for the whole request."""
+        if not self.is_writer:
+            self._check_writer()
+        if not self.is_writer:
+            self._refresh_from_shm()
+        return self._snapshot
+
+    def _check_writer(self):
+        """Take over (or follow a new writer) once the writer process is gone."""
+        now = time.monotonic()
+        if now - self._writer_checked < WRITER_CHECK_INTERVAL:
+            return
+        self._writer_checked = now
+        if _pid_alive(struct.unpack_from('<I', self._shm.buf, 12)[0]):
+            return
+        with self._claim_lock:
+            if self.is_writer:
+                return
+            try:
+                self._claim()
+            except Exception as e:
+                print(f"⚠️  Writer is gone and the segment could not be claimed ({e})")
+                return
+        if self.is_writer and self.on_promote:
+            self.on_promote()
+
+    def _refresh_from_shm(self):
+        buf = self._shm.buf
+        for _ in range(8):
+            _, slot, _, _ = HEADER.unpack_from(buf, 0)
+            base = HEADER.size + slot * self._slot_size
+            seq, length = SLOT_HEADER.unpack_from(buf, base)
+            if seq == 0:
+                return                      # writer has not published yet
+            if (slot, seq) == self._cache_key:
+                return
+            if seq & 1:
+                self.stats['torn_retries'] += 1
+                continue                    # writer is in this slot right now
+            start = base + SLOT_HEADER.size
+            payload = bytes(buf[start:start + length])
+            if SLOT_HEADER.unpack_from(buf, base)[0] != seq:
+                self.stats['torn_retries'] += 1
+                continue                    # overwritten while copying
+            self._snapshot = pickle.loads(payload)
+            self._cache_key = (slot, seq)
+            self.stats['reader_refreshes'] += 1
+            return
+
+    # ---------- writer ----------
+
+    def publish(self, **changes):
+        """Build the next version from the current one plus changes, then swap it in."""
+        with self._write_lock:
+            snap = replace(self._snapshot, version=self._snapshot.version + 1,
+                           published_at=time.time(), **changes)
+            self._snapshot = snap
+            self.stats['publishes'] += 1
+            if self._shm is not None and self.is_writer:
+                self._write_shm(snap)
+            return snap
+
+    def _write_shm(self, snap):
+        payload = pickle.dumps(snap, protocol=pickle.HIGHEST_PROTOCOL)
+        if len(payload) > self._slot_size - SLOT_HEADER.size:
+            self.stats['shm_skipped'] += 1
+            print(f"⚠️  Snapshot v{snap.version} ({len(payload)} B) exceeds shared slot; readers keep v-1")
+            return
+
+        buf = self._shm.buf
+        magic, active, reinit, pid = HEADER.unpack_from(buf, 0)
+        slot = 1 - active
+        base = HEADER.size + slot * self._slot_size
+        seq = SLOT_HEADER.unpack_from(buf, base)[0]
+
+        SLOT_HEADER.pack_into(buf, base, seq + 1, len(payload))
+        start = base + SLOT_HEADER.size
+        buf[start:start + len(payload)] = payload
+        SLOT_HEADER.pack_into(buf, base, seq + 2, len(payload))
+        # Flip the active slot last; only this field changes in the header
+        struct.pack_into('<I', buf, 4, slot)
+        self.stats['shm_bytes'] = len(payload)
+
+    # ---------- cross-process requests ----------
+
+    def request_reinit(self):
+        """Ask the writer (possibly another process) to re-run initialize_data().
+        Concurrent requests may coalesce into one reload, which is all they need."""
+        if self._shm is None:
+            self._reinit_local += 1
+            return
+        buf = self._shm.buf
+        reinit = struct.unpack_from('<I', buf, 8)[0]
+        struct.pack_into('<I', buf, 8, (reinit + 1) & 0xFFFFFFFF)
+
+    def take_reinit_request(self):
+        """Writer side: True once per request_reinit() since the last call."""
+        if self._shm is None:
+            reinit = self._reinit_local
+        else:
+            reinit = struct.unpack_from('<I', self._shm.buf, 8)[0]
+        pending = reinit != self._reinit_seen
+        self._reinit_seen = reinit
+        return pending
+
+
+store = StateStore()
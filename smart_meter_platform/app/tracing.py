@@ -0,0 +1,204 @@
+"""
+End-to-end latency tracing, from sensor sample to published alert.
+
+Each sensor frame carries the device's frame sequence number and its
+monotonic sample time (LFCLK ticks). The collector adds host receive and
+persist times under the log entry's 'trace' key. The writer adds load,
+classify and publish times as the entry moves through initialize_data().
+
+Stages, each with its own histogram:
+    device    sample -> receive (see DeviceClock)
+    ingest    receive -> written to the log
+    watch     written -> picked up by the file watcher
+    classify  picked up -> classified
+    publish   classified -> visible to API readers
+    total     receive -> visible to API readers
+
+Sequence numbers also give gap, duplicate and reset counts per device.
+Only entries received after this process started feed the histograms, so
+replaying an old log on start does not count as latency.
+"""
+import threading
+import time
+from bisect import bisect_left
+from collections import deque
+
+LFCLK_HZ = 32768
+TICK_WRAP = 1 << 32
+BUCKETS_MS = (1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 30000, 60000)
+STAGES = ('device', 'ingest', 'watch', 'classify', 'publish', 'total')
+CLOCK_WINDOW = 300          # seconds of frames the device clock offset is fitted over
+RESET_BACKSTEP = 1000       # a sequence drop larger than this is a device reset
+
+
+class LatencyHistogram:
+    """Fixed millisecond buckets; quantiles are reported as bucket upper bounds."""
+
+    def __init__(self):
+        self.counts = [0] * (len(BUCKETS_MS) + 1)   # last bucket is overflow
+        self.count = 0
+        self.total = 0.0
+        self.max = 0.0
+
+    def add(self, ms):
+        ms = max(ms, 0.0)
+        self.counts[bisect_left(BUCKETS_MS, ms)] += 1
+        self.count += 1
+        self.total += ms
+        self.max = max(self.max, ms)
+
+    def quantile(self, q):
+        if not self.count:
+            return None
+        rank = q * self.count
+        seen = 0
+        for i, n in enumerate(self.counts):
+            seen += n
+            if seen >= rank:
+                return min(BUCKETS_MS[i], round(self.max, 1)) if i < len(BUCKETS_MS) else round(self.max, 1)
+        return round(self.max, 1)
+
+    def to_dict(self):
+        return {
+            'count': self.count,
+            'mean_ms': round(self.total / self.count, 1) if self.count else None,
+            'max_ms': round(self.max, 1),
+            'p50_ms': self.quantile(0.50),
+            'p95_ms': self.quantile(0.95),
+            'p99_ms': self.quantile(0.99),
+            'buckets': [{'le': le, 'count': n} for le, n in zip(BUCKETS_MS + ('inf',), self.counts)]
+        }
+
+
+class DeviceClock:
+    """
+    Maps device ticks onto host time. The device and host clocks are not
+    synchronised, so the offset is fitted from the frame with the least
+    delay in the last CLOCK_WINDOW seconds (a sliding minimum, which also
+    follows crystal drift). Device latencies are therefore relative to the
+    fastest recent frame. The constant part of the link delay is not
+    included.
+    """
+
+    def __init__(self):
+        self.wraps = 0
+        self.last_ticks = None
+        self.window = deque()       # (rx, offset), offsets increasing
+
+    def latency(self, ticks, rx):
+        # The 32-bit tick counter wraps after ~36 hours. Tamper events can
+        # arrive slightly out of tick order, so only a jump of more than
+        # half the range counts as a wrap
+        last = self.last_ticks
+        if last is None or 0 <= ticks - last < TICK_WRAP // 2:
+            self.last_ticks = ticks
+        elif last - ticks > TICK_WRAP // 2:
+            self.wraps += 1
+            self.last_ticks = ticks
+        elif ticks - last > TICK_WRAP // 2:
+            ticks -= TICK_WRAP      # sampled just before the last wrap
+        offset = rx - (ticks + self.wraps * TICK_WRAP) / LFCLK_HZ
+
+        while self.window and self.window[-1][1] >= offset:
+            self.window.pop()
+        self.window.append((rx, offset))
+        while self.window[0][0] < rx - CLOCK_WINDOW:
+            self.window.popleft()
+        return (offset - self.window[0][1]) * 1000
+
+
+class LatencyTracer:
+    def __init__(self):
+        self._lock = threading.Lock()
+        self.started = time.time()
+        self.stages = {s: LatencyHistogram() for s in STAGES}
+        self.devices = {}           # device -> sequence counters
+        self.clocks = {}            # device -> DeviceClock
+        self._loaded = {}           # id(entry) -> (trace, load time, device ms), until classified
+        self._classified = []       # (trace, load, device ms, classify) awaiting publish
+
+    # ---------- stage stamps ----------
+
+    def loaded(self, entries, t=None):
+        """The file watcher read these new log entries, in log order."""
+        t = t or time.time()
+        with self._lock:
+            for entry in entries:
+                trace = entry.get('trace')
+                if not trace or 'rx' not in trace:
+                    continue
+                device = entry.get('node_id', 'serial')
+                fresh = self._check_sequence(device, trace)
+
+                # The clock fit follows every frame, in order, across resets
+                device_ms = None
+                if fresh and 'dev_t' in trace:
+                    device_ms = self.clocks.setdefault(device, DeviceClock()).latency(trace['dev_t'], trace['rx'])
+                if trace['rx'] >= self.started:
+                    self._loaded[id(entry)] = (trace, t, device_ms)
+
+    def classified(self, entry, t=None):
+        """initialize_data() finished with this entry. Returns the classify time."""
+        t = t or time.time()
+        with self._lock:
+            pending = self._loaded.pop(id(entry), None)
+            if pending is not None:
+                self._classified.append(pending + (t,))
+        return t
+
+    def published(self, t=None):
+        """Everything classified so far becomes visible at t; call right before store.publish()."""
+        t = t or time.time()
+        with self._lock:
+            batch, self._classified = self._classified, []
+            self._loaded.clear()
+            for trace, load, device_ms, classify in batch:
+                rx, persist = trace['rx'], trace.get('persist')
+                if device_ms is not None:
+                    self.stages['device'].add(device_ms)
+                if persist:
+                    self.stages['ingest'].add((persist - rx) * 1000)
+                    self.stages['watch'].add((load - persist) * 1000)
+                self.stages['classify'].add((classify - load) * 1000)
+                self.stages['publish'].add((t - classify) * 1000)
+                self.stages['total'].add((t - rx) * 1000)
+        return t
+
+    # ---------- sequence numbers ----------
+
+    def _check_sequence(self, device, trace):
+        """Count gaps, duplicates and resets; False for a duplicate frame."""
+        seq = trace.get('seq')
+        if seq is None:
+            return True     # interrupt-driven tamper entries have no frame number
+        d = self.devices.setdefault(device, {'frames': 0, 'last_seq': None, 'gaps': 0,
+                                             'dropped': 0, 'duplicates': 0, 'resets': 0})
+        d['frames'] += 1
+        last = d['last_seq']
+        if last is not None:
+            if seq == last + 1:
+                pass
+            elif seq > last + 1:
+                d['gaps'] += 1
+                d['dropped'] += seq - last - 1
+            elif last - seq > RESET_BACKSTEP or seq == 1:
+                d['resets'] += 1
+                self.clocks.pop(device, None)
+            else:
+                d['duplicates'] += 1
+                return False
+        d['last_seq'] = seq
+        return True
+
+    # ---------- reporting ----------
+
+    def summary(self):
+        with self._lock:
+            return {
+                'since': self.started,
+                'stages': {s: h.to_dict() for s, h in self.stages.items()},
+                'devices': {dev: dict(d) for dev, d in self.devices.items()}
+            }
+
+
+tracer = LatencyTracer()
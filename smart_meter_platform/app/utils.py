@@ -2,6 +2,7 @@ import random
 import string
 import json
 import os
+import re
 from datetime import datetime
 from typing import List, Dict, Optional
 from app.models import MeterReading, TamperReason
@@ -32,23 +33,110 @@ def generate_mock_reading(node_id: str, force_tamper: bool = False) -> MeterRead
         verified=random.random() > 0.1
     )
 
-def load_sensor_logs(filepath: str) -> List[Dict]:
-    """Load sensor data from JSON file."""
+class SensorLogReader:
+    """
+    Incremental reader for sensor_logs.json. The collector keeps the file
+    one JSON array and only ever writes new entries over its closing
+    bracket (ReadingLog in uart_to_logsJSON.py), so each read() parses
+    just the bytes after the last entry it returned. A read that lands
+    mid-flush does not parse and is retried on the next call. A file that
+    was replaced, shrank or no longer holds the bytes in front of the
+    offset is read again from the start.
+    """
+    MARK = 64       # bytes in front of the offset that must not change
+
+    def __init__(self, filepath: str):
+        self.filepath = filepath
+        self.rewind()
+
+    def rewind(self):
+        """Make the next read() return the whole log again."""
+        self.offset = 0         # just past the last entry returned
+        self.mark = b''
+        self.count = 0          # entries in the log up to offset
+
+    def read(self):
+        """
+        (entries, start): the entries appended since the last call and the
+        log index of the first one. start is 0 when the whole log was read.
+        """
+        try:
+            with open(self.filepath, 'rb') as f:
+                if self.offset and not self._unchanged(f):
+                    print(f"{self.filepath} was rewritten; reading it from the start")
+                    self.rewind()
+                f.seek(self.offset)
+                tail = f.read()
+        except FileNotFoundError:
+            return [], self.count
+
+        # Everything up to the closing bracket: ",\n  {...},\n  {...}" or
+        # the whole "[\n  {...}" on the first read
+        body = tail.rstrip()
+        if not body.endswith(b']'):
+            return [], self.count
+        body = body[:-1].rstrip()
+        entries = body.lstrip()
+        if self.offset == 0:
+            if not entries.startswith(b'['):
+                return [], self.count
+            entries = entries[1:]
+        elif entries.startswith(b','):
+            entries = entries[1:]
+        if not entries.strip():
+            return [], self.count
+        try:
+            entries = json.loads(b'[' + entries + b']')
+        except ValueError:
+            return [], self.count
+
+        start = self.count
+        self.offset += len(body)
+        self.mark = (self.mark + body)[-self.MARK:]
+        self.count += len(entries)
+        return entries, start
+
+    def _unchanged(self, f):
+        f.seek(0, os.SEEK_END)
+        if f.tell() < self.offset:
+            return False
+        f.seek(self.offset - len(self.mark))
+        return f.read(len(self.mark)) == self.mark
+
+def get_capture_dir() -> str:
+    """Directory where the UART bridge stores tamper waveform captures."""
+    base_dir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    return os.path.join(base_dir, 'captures')
+
+def load_capture(capture_id: str) -> Optional[Dict]:
+    """Load one waveform capture by id; None if missing or the id is malformed."""
+    if not re.fullmatch(r'[A-Za-z0-9_\-]+', capture_id or ''):
+        return None
+    path = os.path.join(get_capture_dir(), f"{capture_id}.json")
+    if not os.path.exists(path):
+        return None
     try:
-        if os.path.exists(filepath):
-            with open(filepath, 'r') as f:
-                data = json.load(f)
-                result = data if isinstance(data, list) else []
-                return result
-        else:
-            print(f"Warning: {filepath} not found. Returning empty list.")
-            return []
-    except json.JSONDecodeError as e:
-        print(f"Error reading JSON: {e}")
-        return []
+        with open(path, 'r') as f:
+            return json.load(f)
     except Exception as e:
-        print(f"Error loading sensor logs: {e}")
-        return []
+        print(f"Error loading capture {capture_id}: {e}")
+        return None
+
+def load_ingest_stats() -> Optional[Dict]:
+    """Frame verification metrics the UART bridge writes (see frame_auth.py); None if absent."""
+    base_dir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    try:
+        with open(os.path.join(base_dir, 'ingest_stats.json'), 'r') as f:
+            return json.load(f)
+    except (OSError, ValueError):
+        return None
+
+# Firmware tamper input -> reason, for readings logged from an interrupt
+TAMPER_SOURCE_REASONS = {
+    'cover': 'Physical Access',
+    'reed': 'Magnetic Interference',
+    'light': 'Light Tamper',
+}
 
 def classify_tamper_reason(voltage: float, current: float, light: float) -> Optional[TamperReason]:
     """
@@ -90,10 +178,12 @@ def convert_json_to_meter_reading(json_data: Dict) -> MeterReading:
     # Determine event type
     event_type = 'TAMPER' if json_data.get('tamperFlag', 0) == 1 else 'NORMAL'
     
-    # Classify tamper reason if anomaly detected
+    # Classify tamper reason if anomaly detected; a tamper input interrupt
+    # names its own cause
     tamper_reason = None
     if event_type == 'TAMPER':
-        tamper_reason = classify_tamper_reason(voltage, current, light)
+        tamper_reason = (TAMPER_SOURCE_REASONS.get(json_data.get('tamper_source'))
+                         or classify_tamper_reason(voltage, current, light))
     
     # Calculate realistic confidence based on sensor deviation
     if event_type == 'TAMPER':
@@ -117,9 +207,13 @@ def convert_json_to_meter_reading(json_data: Dict) -> MeterReading:
         tamper_reason=tamper_reason,
         confidence=round(confidence, 1),
         ciphertext=generate_hex_string(32),
-        hmac=generate_hex_string(64),
-        verified=True,
-        health_score=100  # Will be updated by AI model
+        # The collector only logs frames whose HMAC checked out
+        hmac=json_data.get('mac', ''),
+        verified=json_data.get('verified', False),
+        health_score=100,  # Will be updated by AI model
+        thd=json_data.get('thd'),
+        harmonics=json_data.get('harmonics'),
+        harmonics_measured=json_data.get('harmonics_measured', False)
     )
 
 def calculate_alert_severity(confidence: float, alert_type: str) -> str:
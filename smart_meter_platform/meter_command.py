@@ -0,0 +1,99 @@
+import json
+import os
+import socket
+import struct
+import sys
+
+# The collector (uart_to_logsJSON.py) holds the meters' serial ports and
+# writes commands to them on behalf of this script
+COMMAND_ADDR = ('127.0.0.1', int(os.environ.get('SMART_METER_CMD_PORT', 8765)))
+COMMAND_TIMEOUT = 5     # seconds the collector waits for the meter's ack
+
+# Binary command frame: SOF | cmd | len | payload | xor(cmd, len, payload)
+# The leading SOF bytes double as a wake-up preamble for a sleeping meter
+SOF = 0xA5
+PREAMBLE_LEN = 4
+
+CMD_SET_PERIOD = 0x01
+CMD_BURST = 0x02
+CMD_DISPLAY = 0x03
+CMD_QUERY = 0x04
+CMD_CAPTURE_CFG = 0x05
+
+CHANNELS = {
+    'voltage': 0,
+    'current': 1,
+    'temperature': 2,
+    'light': 3,
+    'magnetic': 4,
+    'all': 0xFF,
+}
+
+def encode_command(cmd, payload=b''):
+    check = cmd ^ len(payload)
+    for b in payload:
+        check ^= b
+    return bytes([SOF] * PREAMBLE_LEN + [cmd, len(payload)]) + payload + bytes([check])
+
+def set_period(channel, period_ms):
+    return encode_command(CMD_SET_PERIOD, struct.pack('<BH', CHANNELS[channel], period_ms))
+
+def burst(seconds):
+    return encode_command(CMD_BURST, struct.pack('<H', seconds))
+
+def display(pause):
+    return encode_command(CMD_DISPLAY, bytes([1 if pause else 0]))
+
+def query():
+    return encode_command(CMD_QUERY)
+
+def capture_window(pre, post):
+    return encode_command(CMD_CAPTURE_CFG, struct.pack('<HH', pre, post))
+
+def build_from_args(args):
+    if args[0] == 'period':
+        return set_period(args[1], int(args[2]))
+    if args[0] == 'burst':
+        return burst(int(args[1]))
+    if args[0] == 'display':
+        return display(args[1] == 'pause')
+    if args[0] == 'query':
+        return query()
+    if args[0] == 'capture':
+        return capture_window(int(args[1]), int(args[2]))
+    raise ValueError(f"Unknown command: {args[0]}")
+
+def send(frame, node=None):
+    """Hand a frame to the collector; yields the replies it relays."""
+    with socket.create_connection(COMMAND_ADDR, timeout=COMMAND_TIMEOUT + 2) as sock:
+        sock.sendall((json.dumps({'node': node, 'frame': frame.hex()}) + '\n').encode('utf-8'))
+        for line in sock.makefile('r', encoding='utf-8'):
+            yield json.loads(line)
+
+def main():
+    args = sys.argv[1:]
+    node = None
+    if args[:1] == ['--node'] and len(args) > 1:
+        node, args = args[1], args[2:]
+    if not args:
+        print("Usage: meter_command.py [--node <node id|port>] period <channel|all> <ms> | burst <seconds> | "
+              "display <pause|resume> | query | capture <pre> <post>")
+        return
+
+    frame = build_from_args(args)
+    try:
+        # Status frames until the ack; the collector closes the connection after it
+        for reply in send(frame, node):
+            if 'error' in reply:
+                print(f"Error: {reply['error']}")
+            elif 'sent' in reply:
+                print(f"Sent to {reply['node_id'] or reply['port']}")
+            else:
+                print(json.dumps(reply))
+    except ConnectionRefusedError:
+        print(f"Collector is not running (no command socket on {COMMAND_ADDR[0]}:{COMMAND_ADDR[1]})")
+    except socket.timeout:
+        print("No reply from meter.")
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,107 @@
+"""
+Replay protection in FrameVerifier: streams are keyed on (dev, boot).
+
+Run from smart_meter_platform/:  python -m unittest discover tests
+"""
+import hashlib
+import hmac
+import os
+import sys
+import tempfile
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from frame_auth import FrameVerifier, KeyTable  # noqa: E402
+
+DEV = 'MTR-0A1B2C3D'
+KEY = b'smart-meter-dev-key-change-me!!'
+
+
+def frame(seq, boot, kind=None, dev=DEV, key=KEY):
+    """A signed line as the firmware sends it (without the CR/LF)."""
+    body = '{'
+    if kind:
+        body += f'"frame":"{kind}",'
+    body += f'"seq":{seq},"dev":"{dev}","boot":"{boot}","t":{seq * 3000}'
+    tag = hmac.new(key, body.encode(), hashlib.sha256).hexdigest()[:32]
+    return f'{body},"mac":"{tag}"}}'
+
+
+class ReplayTest(unittest.TestCase):
+
+    def setUp(self):
+        self.dir = tempfile.TemporaryDirectory()
+        self.seq_path = os.path.join(self.dir.name, 'seq.json')
+        self.verifier = self.make()
+
+    def tearDown(self):
+        self.dir.cleanup()
+
+    def make(self):
+        return FrameVerifier(KeyTable({DEV: KEY.hex()}),
+                             quarantine_path=os.path.join(self.dir.name, 'q.jsonl'),
+                             stats_path=None, seq_path=self.seq_path)
+
+    def accepted(self, *lines, verifier=None):
+        return [ok for _, ok in (verifier or self.verifier).verify_batch(list(lines))]
+
+    def test_in_order_frames_pass(self):
+        self.assertEqual(self.accepted(frame(1, 'AAAA0001'), frame(2, 'AAAA0001'),
+                                       frame(3, 'AAAA0001')), [True] * 3)
+
+    def test_replay_within_boot_rejected(self):
+        self.accepted(frame(1, 'AAAA0001'), frame(2, 'AAAA0001'))
+        self.assertEqual(self.accepted(frame(2, 'AAAA0001'), frame(1, 'AAAA0001')), [False, False])
+        self.assertEqual(self.verifier.reasons['replay'], 2)
+
+    def test_reboot_restarts_seq(self):
+        self.accepted(frame(1, 'AAAA0001'), frame(2, 'AAAA0001'), frame(3, 'AAAA0001'))
+        self.assertEqual(self.accepted(frame(1, 'BBBB0002'), frame(2, 'BBBB0002')), [True, True])
+        self.assertEqual(self.verifier.counts['resets'], 1)
+
+    def test_lost_first_frame_after_reboot(self):
+        self.accepted(*[frame(n, 'AAAA0001') for n in range(1, 50)])
+        # seq 1 and 2 of the new boot never arrived
+        self.assertEqual(self.accepted(frame(3, 'BBBB0002'), frame(4, 'BBBB0002')), [True, True])
+
+    def test_old_boot_replayed_after_reboot(self):
+        old = [frame(n, 'AAAA0001') for n in range(1, 6)]
+        self.accepted(*old[:2])
+        self.accepted(frame(1, 'BBBB0002'))
+        # Frames recorded under the previous boot, including ones never delivered
+        self.assertEqual(self.accepted(*old), [False] * 5)
+        self.assertEqual(self.verifier.reasons['stale_boot'], 5)
+        self.assertEqual(self.accepted(frame(2, 'BBBB0002')), [True])
+
+    def test_kinds_are_separate_streams(self):
+        self.assertEqual(self.accepted(frame(5, 'AAAA0001'), frame(1, 'AAAA0001', 'tamper_irq'),
+                                       frame(6, 'AAAA0001')), [True] * 3)
+
+    def test_capture_frames_must_be_signed(self):
+        signed = frame(1, 'AAAA0001', 'capture')
+        unsigned = signed[:signed.rindex(',"mac"')] + '}'
+        self.assertEqual(self.accepted(unsigned, signed), [False, True])
+        self.assertEqual(self.verifier.reasons['unsigned'], 1)
+
+    def test_unsequenced_rejected(self):
+        body = f'{{"seq":1,"dev":"{DEV}","t":0'
+        tag = hmac.new(KEY, body.encode(), hashlib.sha256).hexdigest()[:32]
+        self.assertEqual(self.accepted(f'{body},"mac":"{tag}"}}'), [False])
+        self.assertEqual(self.verifier.reasons['unsequenced'], 1)
+
+    def test_state_survives_restart(self):
+        self.accepted(frame(1, 'AAAA0001'), frame(2, 'AAAA0001'), frame(1, 'BBBB0002'))
+        self.verifier.close()
+        restarted = self.make()
+        self.assertEqual(self.accepted(frame(1, 'BBBB0002'), frame(3, 'AAAA0001'), frame(2, 'BBBB0002'),
+                                       verifier=restarted), [False, False, True])
+
+    def test_bad_mac_rejected(self):
+        line = frame(1, 'AAAA0001', key=b'another key')
+        self.assertEqual(self.accepted(line), [False])
+        self.assertEqual(self.verifier.reasons['bad_mac'], 1)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -1,30 +1,122 @@
 import serial
 import json
 import os
-import random
+import selectors
+import socket
+import time
+from collections import Counter
 from datetime import datetime
+from serial.tools import list_ports
+from frame_auth import FrameVerifier
+from meter_command import COMMAND_ADDR, COMMAND_TIMEOUT
 
-SERIAL_PORT = 'COM6' # Change if needed
+# Ports to read, comma separated (e.g. SMART_METER_PORTS=/dev/ttyACM0,/dev/ttyACM1
+# or COM6). Unset: every USB serial adapter that shows up is opened.
+SERIAL_PORTS = [p.strip() for p in os.environ.get('SMART_METER_PORTS', '').split(',') if p.strip()]
 BAUD_RATE = 115200
 
 # FIX: Get path to 'smart_meter_platform/sensor_logs.json'
 OUTPUT_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'sensor_logs.json')
+CAPTURE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'captures')
 
 # Config
-NUM_NODES = 6
-node_ids = [f"NODE-{str(i+1).zfill(2)}" for i in range(NUM_NODES)]
-current_node_index = 0
+LFCLK_HZ = 32768  # firmware power stats are in LFCLK ticks
+RESCAN_INTERVAL = 5     # seconds between port discovery scans
+POLL_INTERVAL = 0.05    # seconds between reads where select() can't wait on a port (Windows)
+READ_SIZE = 4096        # bytes per non-blocking read
+MAX_LINE = 4096         # a partial line longer than this is noise; it is dropped
+FLUSH_INTERVAL = 0.5    # seconds between rewrites of the log file
 
-def initialize_serial():
-    try:
-        ser = serial.Serial(SERIAL_PORT, baudrate=BAUD_RATE, timeout=1)
-        print(f"Connected to {SERIAL_PORT}")
-        return ser
-    except:
-        print(f"Cannot connect to {SERIAL_PORT}")
-        return None
-
-def save_reading(voltage, current, light, tamper, node_id):
+# (node id, device capture id) -> capture being reassembled from chunk frames
+pending_captures = {}
+CAPTURE_FIELDS = {'v': 'voltage', 'i': 'current', 'tc': 'temperature', 'l': 'lightIntensity', 'm': 'magneticField'}
+WAVE_CYCLE_HZ = 50          # each capture record carries one line cycle of current...
+WAVE_COUNTS_PER_A = 150     # ...in CT counts (HARM_COUNTS_PER_A in the firmware)
+
+# Node id -> its most recent reading; interrupt-driven tamper events are logged against it
+last_reading = {}
+
+# The sensor log shared by every port, created by main()
+reading_log = None
+
+class ReadingLog:
+    """
+    sensor_logs.json, written append-only. The file stays one JSON array.
+    New readings are buffered and written every FLUSH_INTERVAL seconds over
+    the closing bracket (",\n  {...}\n]"), so a flush costs only the new
+    readings however long the log has grown. Nothing already written is
+    kept in memory. The server reads only what was written after the last
+    entry it saw (SensorLogReader in app/utils.py); a read that lands
+    mid-flush does not parse and is retried.
+    """
+
+    def __init__(self, path=OUTPUT_FILE):
+        self.path = path
+        self.pending = []
+        self._last_flush = 0.0
+        self._end, self._has_entries = self._open_array()
+
+    def _open_array(self):
+        """(offset just past the last entry, whether the array has entries),
+        repairing a log that ends mid-reading after a crash or full disk."""
+        if not os.path.exists(self.path) or os.path.getsize(self.path) == 0:
+            with open(self.path, 'wb') as f:
+                f.write(b'[\n]')
+            return 1, False
+        with open(self.path, 'rb') as f:
+            content = f.read()
+        body = content.rstrip()
+        if body.endswith(b']'):
+            entries = body[:-1].rstrip()
+            return len(entries), entries != b'['
+        # Keep every complete reading: cut after the last '}' that closes one
+        end = len(body)
+        while end > 0:
+            end = body.rfind(b'}', 0, end)
+            if end < 0:
+                break
+            try:
+                json.loads(body[:end + 1] + b'\n]')
+            except ValueError:
+                continue
+            print(f"Repaired {self.path}: dropped {len(content) - end - 1} bytes of a partial write")
+            with open(self.path, 'r+b') as f:
+                f.seek(end + 1)
+                f.write(b'\n]')
+                f.truncate()
+            return end + 1, True
+        print(f"⚠️  {self.path} is not a JSON array; starting a new log")
+        os.replace(self.path, self.path + '.corrupt')
+        return self._open_array()
+
+    def append(self, reading):
+        self.pending.append(reading)
+
+    def maybe_flush(self, force=False):
+        now = time.time()
+        if not self.pending or (not force and now - self._last_flush < FLUSH_INTERVAL):
+            return
+        self._last_flush = now
+        # When the write started; the server stamps the later stages (see app/tracing.py)
+        for reading in self.pending:
+            if 'trace' in reading:
+                reading['trace']['persist'] = now
+        body = ',\n'.join('  ' + json.dumps(r) for r in self.pending)
+        chunk = ((',\n' if self._has_entries else '\n') + body + '\n]').encode('utf-8')
+        try:
+            with open(self.path, 'r+b') as f:
+                f.seek(self._end)
+                f.write(chunk)
+                f.truncate()
+        except OSError as e:
+            print(f"Log write failed, retrying: {e}")   # the next flush rewrites from the same offset
+            return
+        self._end += len(chunk) - 2           # back in front of "\n]"
+        self._has_entries = True
+        self.pending = []
+
+def save_reading(voltage, current, light, tamper, node_id, capture_id=None, harmonics=None, thd=None,
+                 tamper_source=None, trace=None, mac=None, harmonics_measured=False):
     # Ensure event_type string is correct
     event_type = "TAMPER" if tamper == 1 else "NORMAL"
     
@@ -37,57 +129,527 @@ def save_reading(voltage, current, light, tamper, node_id):
         "lightIntensity": light,
         "tamperFlag": tamper
     }
+    if capture_id:
+        reading["capture_id"] = capture_id
+    # On-device FFT of the current waveform: THD arrives in per mille
+    if harmonics:
+        reading["harmonics"] = harmonics
+        reading["thd"] = round(thd / 10, 1) if thd is not None else None
+        # Only a sampled CT window is evidence; the firmware marks synthesised ones
+        if harmonics_measured:
+            reading["harmonics_measured"] = True
+    # Tag of a frame that passed HMAC verification
+    if mac:
+        reading["mac"] = mac
+        reading["verified"] = True
+    # Set when a tamper input interrupt, not a periodic sample, produced the entry
+    if tamper_source:
+        reading["tamper_source"] = tamper_source
     
-    # Read existing
-    all_readings = []
-    if os.path.exists(OUTPUT_FILE):
-        try:
-            with open(OUTPUT_FILE, 'r') as f:
-                content = f.read()
-                if content: all_readings = json.loads(content)
-        except: pass
-    
-    # Append
-    all_readings.append(reading)
-    
-    # Write back
-    with open(OUTPUT_FILE, 'w') as f:
-        json.dump(all_readings, f, indent=2)
+    # Device seq/time and host receive time; ReadingLog adds the write time
+    if trace:
+        reading["trace"] = dict(trace)
+
+    global reading_log
+    if reading_log is None:
+        reading_log = ReadingLog()
+    reading_log.append(reading)
     
     print(f"LOGGED: {node_id} - {event_type} | V:{voltage} I:{current}")
 
-def get_next_node_id():
-    global current_node_index
-    nid = node_ids[current_node_index]
-    current_node_index = (current_node_index + 1) % NUM_NODES
-    return nid
+def log_power_stats(data):
+    """Print the low-power residency split reported by the firmware."""
+    modes = ['run', 'sleep', 'stop', 'standby']
+    total = sum(data.get(m, 0) for m in modes) or 1
+    split = ' '.join(f"{m}:{100 * data.get(m, 0) / total:.1f}%" for m in modes)
+
+    wakes = data.get('lat_n_standby', 0)
+    avg_us = data.get('lat_sum_standby', 0) * 1e6 / LFCLK_HZ / wakes if wakes else 0
+    max_us = data.get('lat_max_standby', 0) * 1e6 / LFCLK_HZ
+    print(f"POWER: {split} | standby wake avg {avg_us:.0f}us max {max_us:.0f}us")
+
+def log_boot_stats(data):
+    """Print time-to-first-sample and display bring-up times after a reset."""
+    ms = lambda key: data.get(key, 0) * 1000 / LFCLK_HZ
+    print(f"BOOT: first sample {ms('first_sample'):.1f}ms | "
+          f"lcd ready {ms('lcd_ready'):.0f}ms | first screen {ms('first_screen'):.0f}ms")
+
+def log_fmt_bench(data):
+    """Print the formatter cycle counts from a FMT_BENCH firmware build."""
+    n = data.get('n', 1) or 1
+    print(f"FMT BENCH: {data.get('div', 0) / n:.0f} -> {data.get('recip', 0) / n:.0f} cycles/number | "
+          f"date {data.get('date_div', 0)} -> {data.get('date_recip', 0)} cycles | "
+          f"fixed {data.get('fixed', 0)} cycles")
+
+def log_trend_stats(data):
+    """Print the trend pane's SPI cost per sample against a full-pane repaint."""
+    n = data.get('samples', 0)
+    per_sample = data.get('bytes', 0) / n if n else 0
+    print(f"TREND: {n} samples | {per_sample:.0f} B/sample avg, {data.get('max', 0)} max | "
+          f"repaint would be {data.get('repaint', 0)} B | setup {data.get('init', 0)} B")
+
+def on_tamper_irq(data, rx):
+    """Log a tamper input edge the firmware reported ahead of the next sample."""
+    state = 'ASSERTED' if data.get('active') else 'cleared'
+    queued_ms = data.get('queued', 0) * 1000 / LFCLK_HZ
+    print(f"TAMPER IRQ: {data.get('src')} {state} (#{data.get('seq')}, queued {queued_ms:.1f}ms)")
+    last = last_reading.get(data.get('dev'))
+    if data.get('active') and last:
+        save_reading(last['voltage'], last['current'], last['light'], 1,
+                     data['dev'], tamper_source=data.get('src'),
+                     trace={'dev_t': data.get('t', 0), 'rx': rx}, mac=data.get('mac'))
+
+def log_tamper_stats(data):
+    """Print the worst-case tamper detection-to-transmit latency against its budget."""
+    ms = lambda key: data.get(key, 0) * 1000 / LFCLK_HZ
+    print(f"TAMPER: {data.get('events', 0)} events | latency last {ms('lat_last'):.1f}ms "
+          f"max {ms('lat_max'):.1f}ms (budget {ms('budget'):.0f}ms, {data.get('over_budget', 0)} over) | "
+          f"{data.get('bounces', 0)} bounces, {data.get('dropped', 0)} dropped")
+
+def log_device_reply(data):
+    """Print command acks and counter dumps sent back by the firmware."""
+    print(f"DEVICE: {json.dumps(data)}")
+
+def start_capture(device_capture_id, node_id):
+    """Register a capture announced by a tamper frame; returns its host-side id."""
+    capture_id = f"{node_id}_{datetime.now().strftime('%Y%m%dT%H%M%S')}_{device_capture_id}"
+    pending_captures[(node_id, device_capture_id)] = {
+        'capture_id': capture_id,
+        'node_id': node_id,
+        'timestamp': datetime.now().isoformat(),
+        'chunks': {}
+    }
+    return capture_id
+
+def on_capture_start(data):
+    cap = pending_captures.get((data.get('dev'), data.get('id')))
+    if cap is not None:
+        cap['records'] = data.get('records', 0)
+        cap['trigger_index'] = data.get('trigger', 0)
+        cap['wave_n'] = data.get('wave_n', 0)
+
+def on_capture_chunk(data):
+    cap = pending_captures.get((data.get('dev'), data.get('id')))
+    if cap is not None:
+        cap['chunks'][data.get('first', 0)] = data
+
+def on_capture_end(data):
+    cap = pending_captures.pop((data.get('dev'), data.get('id')), None)
+    if cap is not None:
+        save_capture(cap)
+
+def save_capture(cap):
+    """Write a reassembled waveform next to the logs, keyed by the alert's capture_id."""
+    samples = {'t_ms': [], 'current_waveform': []}
+    samples.update({name: [] for name in CAPTURE_FIELDS.values()})
+    for seq in sorted(cap['chunks']):
+        chunk = cap['chunks'][seq]
+        samples['t_ms'].extend(round(t * 1000 / LFCLK_HZ, 2) for t in chunk.get('dt', []))
+        for key, name in CAPTURE_FIELDS.items():
+            samples[name].extend(chunk.get(key, []))
+        # One list of amps per record, sampled at wave_rate_hz
+        samples['current_waveform'].extend([round(x / WAVE_COUNTS_PER_A, 3) for x in cycle]
+                                           for cycle in chunk.get('w', []))
+
+    document = {
+        'capture_id': cap['capture_id'],
+        'node_id': cap['node_id'],
+        'timestamp': cap['timestamp'],
+        'trigger_index': cap.get('trigger_index', 0),
+        'records': cap.get('records', 0),
+        'wave_rate_hz': cap.get('wave_n', 0) * WAVE_CYCLE_HZ,
+        'complete': len(samples['t_ms']) == cap.get('records', 0),
+        'samples': samples
+    }
+
+    os.makedirs(CAPTURE_DIR, exist_ok=True)
+    with open(os.path.join(CAPTURE_DIR, f"{cap['capture_id']}.json"), 'w') as f:
+        json.dump(document, f)
+    print(f"CAPTURE: {cap['capture_id']} ({len(samples['t_ms'])}/{document['records']} records)")
+
+STATUS_HANDLERS = {
+    'power': log_power_stats,
+    'boot': log_boot_stats,
+    'ack': log_device_reply,
+    'counters': log_device_reply,
+    'fmt_bench': log_fmt_bench,
+    'trend': log_trend_stats,
+    'tamper': log_tamper_stats,
+    'capture_start': on_capture_start,
+    'capture': on_capture_chunk,
+    'capture_end': on_capture_end,
+}
+
+def handle_status_frame(data, rx):
+    if data.get('frame') == 'tamper_irq':
+        on_tamper_irq(data, rx)
+        return
+    handler = STATUS_HANDLERS.get(data.get('frame'))
+    if handler:
+        handler(data)
+
+def handle_frame(data, rx, port):
+    """Route one verified frame: status frames to their handler, readings to the log."""
+    # Readings name their device; other frames from the same port belong to it too
+    if data.get('dev'):
+        port.node_id = data['dev']
+    data.setdefault('dev', port.node_id or port.name)
+    node_id = data['dev']
+
+    # Status frames are not readings
+    if 'frame' in data:
+        handle_status_frame(data, rx)
+        return False
+    capture_id = None
+    if 'capture' in data:
+        capture_id = start_capture(data['capture'], node_id)
+    save_reading(
+        data.get('voltage',0), 
+        data.get('current',0), 
+        data.get('lightIntensity',0), 
+        data.get('tamperFlag',0), 
+        node_id,
+        capture_id,
+        data.get('harm'),
+        data.get('thd'),
+        trace={'seq': data['seq'], 'dev_t': data.get('t', 0), 'rx': rx} if 'seq' in data else None,
+        mac=data.get('mac'),
+        harmonics_measured=data.get('hsim') == 0
+    )
+    last_reading[node_id] = {'voltage': data.get('voltage', 0),
+                             'current': data.get('current', 0),
+                             'light': data.get('lightIntensity', 0)}
+    return True
+
+class SerialPort:
+    """
+    One tty. Reads never block: each read takes whatever the driver has
+    buffered and complete lines are cut from the port's own reassembly
+    buffer, so a frame split across reads (or ports) is never mixed up.
+    The counters survive reconnects.
+    """
+
+    def __init__(self, path):
+        self.path = path
+        self.name = f"PORT-{os.path.basename(path)}"    # until the device names itself
+        self.node_id = None                             # 'dev' field of its frames
+        self.ser = None
+        self.fd = None
+        self.buf = bytearray()
+        self.counts = Counter()
+        self.last_rx = None
+        self.listeners = []                             # (socket, deadline) of meter_command.py clients
+        self._rate_at = time.time()
+        self._rate_counts = Counter()
+
+    def open(self):
+        self.ser = serial.Serial(self.path, baudrate=BAUD_RATE, timeout=0)
+        # select() and os.read() work on the tty fd directly, except on Windows
+        self.fd = self.ser.fileno() if os.name != 'nt' else None
+        self.buf.clear()
+        self.counts['connects'] += 1
+
+    def close(self):
+        try:
+            if self.ser: self.ser.close()
+        except: pass
+        self.ser = self.fd = None
+
+    def write(self, data):
+        self.ser.write(data)
+        self.counts['commands'] += 1
+
+    def read_lines(self):
+        """Complete lines received since the last call. Raises OSError or
+        SerialException when the device has gone away."""
+        if self.fd is not None:
+            try:
+                chunk = os.read(self.fd, READ_SIZE)
+            except BlockingIOError:
+                return []
+            if not chunk:
+                raise OSError("device disconnected")    # readable with no data: hung up
+        else:
+            chunk = self.ser.read(self.ser.in_waiting)
+            if not chunk:
+                return []
+
+        self.counts['bytes'] += len(chunk)
+        self.last_rx = time.time()
+        self.buf += chunk
+        end = self.buf.rfind(b'\n')
+        if end < 0:
+            if len(self.buf) > MAX_LINE:
+                self.counts['overflows'] += 1
+                self.buf.clear()
+            return []
+        raw = self.buf[:end].split(b'\n')
+        del self.buf[:end + 1]
+
+        lines = []
+        for line in raw:
+            if len(line) > MAX_LINE:
+                self.counts['overflows'] += 1
+                continue
+            line = line.decode('utf-8', errors='ignore').strip()
+            if line:
+                lines.append(line)
+        self.counts['lines'] += len(lines)
+        return lines
+
+    def stats(self, now):
+        elapsed = max(now - self._rate_at, 1e-6)
+        rate = lambda key: round((self.counts[key] - self._rate_counts[key]) / elapsed, 1)
+        out = {
+            'node_id': self.node_id,
+            'connected': self.ser is not None,
+            'last_rx': self.last_rx,
+            'lines_per_s': rate('lines'),
+            'bytes_per_s': rate('bytes'),
+        }
+        out.update(self.counts)
+        self._rate_at, self._rate_counts = now, Counter(self.counts)
+        return out
+
+class Collector:
+    """
+    Reads every meter port from one thread. The ports are registered with
+    a selector (epoll on Linux), so the loop sleeps until a port has data
+    and then reads only the ports that do. The lines of all ready ports go
+    through frame verification as one batch.
+    """
+
+    def __init__(self, verifier, paths=SERIAL_PORTS):
+        self.verifier = verifier
+        self.paths = paths
+        self.ports = {}                 # path -> SerialPort, kept after a disconnect
+        self.selector = selectors.DefaultSelector()
+        self._server = None
+        self._clients = {}              # command socket -> request bytes received so far
+        self._unavailable = set()
+        self._last_scan = 0.0
+
+    def discover(self):
+        if self.paths:
+            return self.paths
+        # Meters sit behind USB-UART bridges; skip the board's built-in ttyS ports
+        return [p.device for p in list_ports.comports() if p.vid is not None]
+
+    def rescan(self):
+        self._last_scan = time.time()
+        for path in self.discover():
+            port = self.ports.setdefault(path, SerialPort(path))
+            if port.ser is not None:
+                continue
+            try:
+                port.open()
+            except (OSError, serial.SerialException) as e:
+                if path not in self._unavailable:
+                    print(f"Cannot connect to {path}: {e}")
+                    self._unavailable.add(path)
+                continue
+            self._unavailable.discard(path)
+            if port.fd is not None:
+                self.selector.register(port.fd, selectors.EVENT_READ, port)
+            print(f"Connected to {path}")
+
+    def drop(self, port, error):
+        port.counts['errors'] += 1
+        print(f"Lost {port.path}: {error}")
+        if port.fd is not None:
+            self.selector.unregister(port.fd)
+        port.close()
+        for conn, _ in port.listeners:
+            self._reply(conn, {'error': f"{port.path} disconnected"})
+            self._close_client(conn)
+
+    def poll(self, timeout):
+        if os.name == 'nt':
+            timeout = POLL_INTERVAL     # select() can't wait on a COM port; poll them all
+        if self.selector.get_map():
+            events = self.selector.select(timeout)
+        else:
+            time.sleep(timeout)
+            events = []
+        ready = []
+        for key, _ in events:
+            if isinstance(key.data, SerialPort):
+                ready.append(key.data)
+            else:
+                key.data(key.fileobj)   # command socket
+        if os.name == 'nt':
+            ready = [p for p in self.ports.values() if p.ser is not None]
+        sources, lines = [], []
+        for port in ready:
+            try:
+                new = port.read_lines()
+            except (OSError, serial.SerialException) as e:
+                self.drop(port, e)
+                continue
+            sources.extend([port] * len(new))
+            lines.extend(new)
+        if lines:
+            self.ingest(sources, lines, time.time())
+
+    def ingest(self, sources, lines, rx):
+        """Verify the lines of every ready port as one batch, then route them."""
+        for port, (data, ok) in zip(sources, self.verifier.verify_batch(lines, rx)):
+            if data is None:
+                continue
+            if not ok:
+                port.counts['rejected'] += 1
+                continue
+            try:
+                reading = handle_frame(data, rx, port)
+                port.counts['readings' if reading else 'status_frames'] += 1
+            except Exception:
+                port.counts['malformed'] += 1
+                continue
+            if port.listeners and not reading:
+                self._forward(port, data)
+
+    # ---------- command socket (meter_command.py) ----------
+    # The collector holds every meter's tty, so commands go through it:
+    # a client sends one {"node": ..., "frame": "<hex>"} line, the frame is
+    # written to that node's port, and the port's status frames are relayed
+    # back until the meter acks or COMMAND_TIMEOUT passes.
+
+    def open_command_socket(self):
+        try:
+            server = socket.create_server(COMMAND_ADDR)
+        except OSError as e:
+            print(f"Command socket disabled ({e})")
+            return
+        server.setblocking(False)
+        self.selector.register(server, selectors.EVENT_READ, self._accept)
+        self._server = server
+        print(f"Commands on {COMMAND_ADDR[0]}:{COMMAND_ADDR[1]}")
+
+    def _accept(self, server):
+        try:
+            conn, _ = server.accept()
+        except OSError:
+            return
+        conn.setblocking(False)
+        self._clients[conn] = b''
+        self.selector.register(conn, selectors.EVENT_READ, self._client_data)
+
+    def _client_data(self, conn):
+        try:
+            data = conn.recv(1024)
+        except BlockingIOError:
+            return
+        except OSError:
+            data = b''
+        if not data:
+            self._close_client(conn)
+            return
+        if conn not in self._clients or self._clients[conn] is None:
+            return                      # one request per connection
+        request = self._clients[conn] + data
+        if b'\n' not in request:
+            self._clients[conn] = request[-1024:]
+            return
+        self._clients[conn] = None
+        self._command(conn, request.split(b'\n', 1)[0])
+
+    def _command(self, conn, line):
+        try:
+            request = json.loads(line)
+            frame = bytes.fromhex(request['frame'])
+        except (ValueError, KeyError, TypeError):
+            self._reply(conn, {'error': 'bad request'})
+            self._close_client(conn)
+            return
+
+        connected = [p for p in self.ports.values() if p.ser is not None]
+        node = request.get('node')
+        matches = [p for p in connected if node in (p.node_id, p.path, p.name)] if node else connected
+        if len(matches) != 1:
+            known = [p.node_id or p.path for p in connected]
+            self._reply(conn, {'error': f"{'no' if not matches else 'more than one'} meter matches; connected: {known}"})
+            self._close_client(conn)
+            return
+
+        port = matches[0]
+        try:
+            port.write(frame)
+        except (OSError, serial.SerialException) as e:
+            self._reply(conn, {'error': str(e)})
+            self._close_client(conn)
+            self.drop(port, e)
+            return
+        port.listeners.append((conn, time.time() + COMMAND_TIMEOUT))
+        self._reply(conn, {'sent': len(frame), 'node_id': port.node_id, 'port': port.path})
+
+    def _forward(self, port, data):
+        for conn, _ in list(port.listeners):
+            self._reply(conn, data)
+        if data.get('frame') == 'ack':
+            for conn, _ in list(port.listeners):
+                self._close_client(conn)
+
+    def _expire_commands(self, now):
+        for port in self.ports.values():
+            for conn, deadline in list(port.listeners):
+                if now > deadline:
+                    self._reply(conn, {'error': 'no reply from meter'})
+                    self._close_client(conn)
+
+    def _reply(self, conn, data):
+        try:
+            conn.sendall((json.dumps(data) + '\n').encode('utf-8'))
+        except OSError:
+            pass                        # client went away; closed on its EOF
+
+    def _close_client(self, conn):
+        for port in self.ports.values():
+            port.listeners = [(c, d) for c, d in port.listeners if c is not conn]
+        if self._clients.pop(conn, False) is not False:
+            self.selector.unregister(conn)
+        conn.close()
+
+    def port_stats(self):
+        now = time.time()
+        return {'ports': {path: port.stats(now) for path, port in self.ports.items()}}
+
+    def run(self):
+        while True:
+            now = time.time()
+            if now - self._last_scan >= RESCAN_INTERVAL:
+                self.rescan()
+            self.poll(FLUSH_INTERVAL / 2)
+            self._expire_commands(time.time())
+            if reading_log:
+                reading_log.maybe_flush()
+            self.verifier.maybe_save_stats(extra=self.port_stats)
+
+    def close(self):
+        for conn in list(self._clients):
+            self._close_client(conn)
+        if self._server:
+            self._server.close()
+        for port in self.ports.values():
+            port.close()
+        self.selector.close()
 
 def main():
-    ser = initialize_serial()
-    if not ser: return
+    global reading_log
+    reading_log = ReadingLog()
+    verifier = FrameVerifier()
+    collector = Collector(verifier)
+    collector.open_command_socket()
 
     print(f"Writing to: {OUTPUT_FILE}")
+    print(f"Ports: {', '.join(SERIAL_PORTS) if SERIAL_PORTS else 'auto-discover (USB serial)'}")
     try:
-        while True:
-            if ser.in_waiting > 0:
-                line = ser.readline().decode('utf-8', errors='ignore').strip()
-                if line:
-                    try:
-                        data = json.loads(line)
-                        node_id = get_next_node_id()
-                        save_reading(
-                            data.get('voltage',0), 
-                            data.get('current',0), 
-                            data.get('lightIntensity',0), 
-                            data.get('tamperFlag',0), 
-                            node_id
-                        )
-                    except: pass
+        collector.run()
     except KeyboardInterrupt:
         print("Stopped.")
     finally:
-        if ser: ser.close()
+        reading_log.maybe_flush(force=True)
+        verifier.close(extra=collector.port_stats)
+        collector.close()
 
 if __name__ == "__main__":
     main()
-    